@@ -5,10 +5,14 @@
 #ifndef BLACKBOX_DATASTORE_H
 #define BLACKBOX_DATASTORE_H
 
+#include <atomic>
+
 #include <sqlite3.h>
 
 #include "state.h"
+#include "summary.h"
 #include "logger.h"
+#include "profile.h"
 
 struct Flight
 {
@@ -18,6 +22,20 @@ struct Flight
     std::string icaoType;
     std::string flightId;
     uint64_t startTime = 0;
+
+    FlightSummary summary;
+};
+
+// Anything left empty or 0 isn't filtered on
+struct FlightQuery
+{
+    // Matched against the start of words in the origin, destination, aircraft type and flight code
+    std::string text;
+    uint64_t fromTime = 0;
+    uint64_t toTime = 0;
+    std::string aircraftType;
+
+    [[nodiscard]] bool empty() const { return text.empty() && fromTime == 0 && toTime == 0 && aircraftType.empty(); }
 };
 
 class DataStore : BlackBox::Logger
@@ -25,25 +43,94 @@ class DataStore : BlackBox::Logger
     sqlite3* m_db = nullptr;
     sqlite3_stmt* m_writeStatusStatement = nullptr;
     sqlite3_stmt* m_fetchStatusStatement = nullptr;
+    sqlite3_stmt* m_updatePhaseStatement = nullptr;
+    sqlite3_stmt* m_writeSummaryStatement = nullptr;
+    sqlite3_stmt* m_fetchWindowStatement = nullptr;
+    sqlite3_stmt* m_fetchStateAtStatement = nullptr;
+    sqlite3_stmt* m_dataVersionStatement = nullptr;
+    std::string m_path;
+
+    // Updated from the WAL hook after every commit
+    std::atomic<int> m_walFrames = 0;
+    std::atomic<int> m_checkpointedFrames = 0;
+    std::atomic<uint64_t> m_bytesWritten = 0;
+    int m_pageSize = 4096;
+
+    static int walHook(void* arg, sqlite3* db, const char* dbName, int frames);
+
+    bool migrate();
 
  public:
     DataStore();
     ~DataStore();
 
     bool init(std::string dbPath);
+    [[nodiscard]] const std::string& getPath() const { return m_path; }
 
     uint64_t createFlight(Flight &flight);
     void updateFlight(const Flight &flight);
 
-    std::vector<Flight> fetchFlights();
+    // Flights with an id of at least fromId, oldest first
+    std::vector<Flight> fetchFlights(uint64_t fromId = 0);
+
+    // Ids of the flights that match, oldest first
+    std::vector<uint64_t> searchFlights(const FlightQuery& query);
+
+    int writeState(uint64_t flightId, const State &state);
+    // If stateIds is given, it's filled with the row id of each state
+    std::vector<State> fetchUpdates(uint64_t flightId, uint64_t sinceTimestamp, std::vector<uint64_t>* stateIds = nullptr);
+    std::vector<uint64_t> fetchTimestamps(uint64_t flightId, uint64_t sinceTimestamp);
 
-    void writeState(uint64_t flightId, const State &state);
-    std::vector<State> fetchUpdates(uint64_t flightId, uint64_t sinceTimestamp);
+    // States from fromTimestamp to toTimestamp inclusive, straight off the (flight_id, timestamp) index
+    std::vector<State> fetchWindow(uint64_t flightId, uint64_t fromTimestamp, uint64_t toTimestamp);
 
-    void startTransaction();
-    void commitTransaction();
+    // The last state at or before timestamp. Returns false if there isn't one.
+    bool fetchStateAt(uint64_t flightId, uint64_t timestamp, State& state);
 
+    // Just what the charts need, without building a State for every sample
+    bool fetchProfile(uint64_t flightId, Profile& profile);
+
+    // Rewrites the phase and event of a state that's already been written
+    int updatePhase(uint64_t stateId, const State& state);
+
+    // Returns false if the flight hasn't been summarised yet
+    bool fetchSummary(uint64_t flightId, FlightSummary& summary);
+    int writeSummary(uint64_t flightId, const FlightSummary& summary);
+
+    // Works out the summary from scratch from the flight's states
+    FlightSummary summariseFlight(uint64_t flightId);
+
+    // Summarises any flights recorded before there were summaries, summarised is how many were
+    int backfillSummaries(size_t* summarised = nullptr);
+
+    int startTransaction();
+    int commitTransaction();
+    void rollbackTransaction();
+
+    // Whether commits are synced to disk, rather than just at checkpoints
+    int setDurable(bool durable);
+
+    // Size of the WAL that hasn't been copied back in to the database yet
+    [[nodiscard]] uint64_t getPendingWALSize() const;
+    [[nodiscard]] uint64_t getBytesWritten() const { return m_bytesWritten; }
+    bool checkpoint();
+
+    // Changes whenever another connection, such as the plugin's, commits. Only looks at shared memory,
+    // so it's cheap enough to call on a timer.
+    uint64_t getDataVersion();
+
+    // Hides the flight straight away. Its states are removed later by purgeFlight(), a batch at a
+    // time, so the write lock is never held for long.
     void deleteFlight(uint64_t flightId);
+    std::vector<uint64_t> fetchDeletedFlights();
+
+    // Removes up to limit of a deleted flight's states, or the flight itself once there are none
+    // left. Returns how many states went, 0 once it's all gone, or -1 on error.
+    int purgeFlight(uint64_t flightId, int limit);
+
+    // Gives up to pages free pages back to the file system. Returns how many are still free, or -1
+    // on error. Always 0 unless the database was created with incremental auto vacuum.
+    int reclaimSpace(int pages);
 };
 
 
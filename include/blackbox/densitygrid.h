@@ -0,0 +1,84 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_DENSITYGRID_H
+#define BLACKBOX_DENSITYGRID_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+
+// How many flights have passed through each part of the world, counted at every zoom level up to
+// MAX_LEVEL using the same tiles as the map. Flights are added a few points at a time as they're
+// recorded and can be taken out again, so the logbook never has to be read again from scratch.
+// Safe to use from more than one thread.
+class DensityGrid : BlackBox::Logger
+{
+ public:
+    // Bins are ~2.5km across at the equator at the deepest level, which keeps a logbook that's been
+    // all over the world to a few hundred MB at most. The map smooths them out past that.
+    static constexpr int MAX_LEVEL = 9;
+    static constexpr int LEVELS = MAX_LEVEL + 1;
+
+    // Bins along each side of a tile
+    static constexpr int BINS = 32;
+
+    using Tile = std::array<uint32_t, BINS * BINS>;
+
+ private:
+    struct FlightProgress
+    {
+        uint64_t lastTimestamp = 0;
+        // Where the flight was at each level, so a flight sitting in a bin only counts once
+        std::array<uint64_t, LEVELS> lastBins;
+
+        FlightProgress() { lastBins.fill(UINT64_MAX); }
+    };
+
+    mutable std::mutex m_mutex;
+    std::array<std::map<uint64_t, Tile>, LEVELS> m_levels;
+    mutable std::array<uint32_t, LEVELS> m_maxCounts = {};
+    mutable bool m_maxDirty = false;
+    std::map<uint64_t, FlightProgress> m_flights;
+
+    void apply(
+        std::array<uint64_t, LEVELS>& lastBins,
+        const double* latitudes,
+        const double* longitudes,
+        size_t count,
+        int delta);
+    void updateMaxCounts() const;
+
+ public:
+    DensityGrid();
+    ~DensityGrid() override = default;
+
+    // Adds states recorded since the flight was last added. lastTimestamp is the newest of them.
+    void addFlight(uint64_t flightId, const double* latitudes, const double* longitudes, size_t count, uint64_t lastTimestamp);
+
+    // Takes the flight back out, given every state it has
+    void removeFlight(uint64_t flightId, const double* latitudes, const double* longitudes, size_t count);
+
+    void clear();
+
+    // Zero if it hasn't been added
+    [[nodiscard]] uint64_t getLastTimestamp(uint64_t flightId) const;
+    [[nodiscard]] std::map<uint64_t, uint64_t> getFlights() const;
+
+    // Copies out the tile, returns false if nothing has been through it
+    bool getTile(int level, int x, int y, Tile& tile) const;
+
+    // The busiest bin at a level, for scaling the colours
+    [[nodiscard]] uint32_t getMaxCount(int level) const;
+
+    bool save(const std::string& path);
+    bool load(const std::string& path);
+};
+
+#endif //BLACKBOX_DENSITYGRID_H
@@ -0,0 +1,79 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_GEO_H
+#define BLACKBOX_GEO_H
+
+#include <algorithm>
+#include <cstddef>
+
+#include <ufc/geoutils.h>
+
+constexpr double KM_TO_NM = 0.539957;
+
+// Box around everything added so far, in degrees
+struct GeoBounds
+{
+    double minLatitude = 0.0;
+    double maxLatitude = 0.0;
+    double minLongitude = 0.0;
+    double maxLongitude = 0.0;
+    bool empty = true;
+
+    void add(double latitude, double longitude)
+    {
+        if (empty)
+        {
+            minLatitude = maxLatitude = latitude;
+            minLongitude = maxLongitude = longitude;
+            empty = false;
+            return;
+        }
+        minLatitude = std::min(minLatitude, latitude);
+        maxLatitude = std::max(maxLatitude, latitude);
+        minLongitude = std::min(minLongitude, longitude);
+        maxLongitude = std::max(maxLongitude, longitude);
+    }
+
+    void clear() { *this = GeoBounds(); }
+};
+
+float degreesToRadians(float degrees);
+
+// Great circle distance in kilometres
+double distance(UFC::Coordinate c1, UFC::Coordinate c2);
+
+// Length in kilometres of the track through count points, given as separate latitude and longitude
+// arrays in degrees. If given, segments gets the count - 1 leg lengths and cumulative gets the
+// distance along the track to each of the count points. Uses AVX2 when the CPU has it.
+double trackDistance(
+    const double* latitudes,
+    const double* longitudes,
+    size_t count,
+    double* segments = nullptr,
+    double* cumulative = nullptr);
+
+// The same using the standard library, for checking and CPUs without AVX2
+double trackDistanceScalar(
+    const double* latitudes,
+    const double* longitudes,
+    size_t count,
+    double* segments = nullptr,
+    double* cumulative = nullptr);
+
+bool hasAVX2();
+
+// Web Mercator (EPSG:3857) in metres, the same as QGeoView's default projection with y increasing southwards
+void toWebMercator(double latitude, double longitude, double& x, double& y);
+
+// The same for count points at once, using AVX2 when the CPU has it
+void toWebMercator(const double* latitudes, const double* longitudes, size_t count, double* x, double* y);
+
+// One point at a time, for checking and CPUs without AVX2
+void toWebMercatorScalar(const double* latitudes, const double* longitudes, size_t count, double* x, double* y);
+
+// Where you'd end up going distance kilometres from start on the initial bearing in degrees
+UFC::Coordinate destination(UFC::Coordinate start, double bearing, double distance);
+
+#endif //BLACKBOX_GEO_H
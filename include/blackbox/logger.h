@@ -23,6 +23,13 @@
 
 #include <string>
 
+// Lets the compiler check log() arguments against the format
+#if defined(__GNUC__)
+#define BLACKBOX_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#define BLACKBOX_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
 namespace BlackBox {
 
 enum LoggerLevel_t
@@ -54,10 +61,10 @@ class Logger
     void setLoggerName(const std::string &name);
     void setLoggerName(const std::wstring &name);
 
-    void log(LoggerLevel_t level, const char* format, ...);
+    void log(LoggerLevel_t level, const char* format, ...) BLACKBOX_PRINTF_FORMAT(3, 4);
     void logv(LoggerLevel_t level, const char* format, va_list ap);
-    void debug(const char* format, ...);
-    void error(const char* format, ...);
+    void debug(const char* format, ...) BLACKBOX_PRINTF_FORMAT(2, 3);
+    void error(const char* format, ...) BLACKBOX_PRINTF_FORMAT(2, 3);
 
     // Not thread safe!
     void pushDepth() { m_depth++; }
@@ -0,0 +1,254 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_PHASES_H
+#define BLACKBOX_PHASES_H
+
+#include <array>
+#include <span>
+
+#include "state.h"
+
+// Everything that decides when we move between phases, so flights can be re-classified when they change
+struct PhaseThresholds
+{
+    float takeOffSpeed = 40.0f;     // Knots on the ground
+    float liftOffSpeed = 20.0f;     // Knots with some wheels off the ground
+    float descendingFPM = -100.0f;
+    float climbingFPM = 500.0f;
+    float approachAGL = 1000.0f;    // Feet
+    float goAroundAGL = 100.0f;     // Feet, after touching down
+    float taxiSpeed = 40.0f;        // Knots, to have finished landing
+    float stoppedFPM = 10.0f;
+};
+
+// The only things the phases depend on. Filled from X-Plane by the plugin or from stored states.
+struct PhaseInput
+{
+    bool parkingBrake = true;
+    bool anyOnGround = true;
+    bool allOnGround = true;
+    float groundSpeed = 0.0f;
+    float agl = 0.0f;
+    float fpmAverage = 0.0f;
+
+    static constexpr PhaseInput fromState(const State& state)
+    {
+        return {
+            state.parkingBrake,
+            state.anyOnGround,
+            state.allOnGround,
+            state.groundSpeed,
+            state.agl,
+            state.fpmAverage};
+    }
+};
+
+typedef bool (*PhaseCondition)(const PhaseInput& in, const PhaseInput& prev, const PhaseThresholds& t);
+
+struct PhaseTransition
+{
+    FlightPhase from;
+    PhaseCondition condition;
+
+    // Transitions to the same phase just report something interesting
+    FlightPhase to;
+    EventType event;
+    const char* message;
+
+    // The message should have the vertical speed and G-force added to it
+    bool reportForces = false;
+};
+
+// Checked in order, the first matching transition for the current phase wins. Changes of phase
+// come before the notes so they aren't hidden when stored states are further apart than a frame.
+constexpr std::array PHASE_TRANSITIONS = {
+    PhaseTransition{
+        FlightPhase::INIT,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds&) { return in.allOnGround; },
+        FlightPhase::PARKED, EventType::NONE, "Starting in PARKED phase"},
+    PhaseTransition{
+        FlightPhase::INIT,
+        [](const PhaseInput&, const PhaseInput&, const PhaseThresholds&) { return true; },
+        FlightPhase::FLIGHT, EventType::NONE, "Starting in FLIGHT phase"},
+
+    PhaseTransition{
+        FlightPhase::PARKED,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds&) { return !in.parkingBrake; },
+        FlightPhase::TAXI, EventType::NONE, "PARKED: Parking brake released, taxiing"},
+    PhaseTransition{
+        FlightPhase::PARKED,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds&) { return !in.allOnGround; },
+        FlightPhase::PARKED, EventType::NONE, "PARKED: Wheels aren't all on ground??"},
+
+    PhaseTransition{
+        FlightPhase::TAXI,
+        [](const PhaseInput& in, const PhaseInput& prev, const PhaseThresholds&) { return in.parkingBrake && !prev.parkingBrake; },
+        FlightPhase::PARKED, EventType::NONE, "TAXI: Parking brake set, parked"},
+    PhaseTransition{
+        FlightPhase::TAXI,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds& t)
+        {
+            return in.groundSpeed > t.takeOffSpeed || (in.groundSpeed > t.liftOffSpeed && !in.allOnGround);
+        },
+        FlightPhase::TAKE_OFF, EventType::NONE, "TAXI: Looks like we're taking off!"},
+
+    PhaseTransition{
+        FlightPhase::TAKE_OFF,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds&) { return !in.anyOnGround; },
+        FlightPhase::FLIGHT, EventType::TAKE_OFF, "TAKE_OFF: We're up!"},
+    PhaseTransition{
+        FlightPhase::TAKE_OFF,
+        [](const PhaseInput& in, const PhaseInput& prev, const PhaseThresholds&) { return !in.allOnGround && prev.allOnGround; },
+        FlightPhase::TAKE_OFF, EventType::NONE, "TAKE_OFF: Rotating"},
+
+    PhaseTransition{
+        FlightPhase::FLIGHT,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds& t)
+        {
+            return in.fpmAverage < t.descendingFPM && in.agl < t.approachAGL;
+        },
+        FlightPhase::APPROACH, EventType::NONE, "DESCENT: Approaching ground"},
+
+    PhaseTransition{
+        FlightPhase::APPROACH,
+        [](const PhaseInput& in, const PhaseInput& prev, const PhaseThresholds&) { return in.anyOnGround && !prev.anyOnGround; },
+        FlightPhase::LANDING, EventType::LANDING, "APPROACH: Landing Started"},
+    PhaseTransition{
+        FlightPhase::APPROACH,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds& t)
+        {
+            return in.fpmAverage > t.climbingFPM && in.agl > t.approachAGL;
+        },
+        FlightPhase::FLIGHT, EventType::NONE, "APPROACH: Go around??"},
+
+    PhaseTransition{
+        FlightPhase::LANDING,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds& t)
+        {
+            return in.fpmAverage < t.stoppedFPM && in.allOnGround && in.groundSpeed < t.taxiSpeed;
+        },
+        FlightPhase::TAXI, EventType::NONE, "LANDING: Slowed down to taxiing"},
+    PhaseTransition{
+        FlightPhase::LANDING,
+        [](const PhaseInput& in, const PhaseInput&, const PhaseThresholds& t) { return !in.anyOnGround && in.agl > t.goAroundAGL; },
+        FlightPhase::FLIGHT, EventType::NONE, "LANDING: Go around?"},
+    PhaseTransition{
+        FlightPhase::LANDING,
+        [](const PhaseInput& in, const PhaseInput& prev, const PhaseThresholds&) { return !in.anyOnGround && prev.anyOnGround; },
+        FlightPhase::LANDING, EventType::NONE, "LANDING: Bounce!"},
+    PhaseTransition{
+        FlightPhase::LANDING,
+        [](const PhaseInput& in, const PhaseInput& prev, const PhaseThresholds&) { return in.allOnGround && !prev.allOnGround; },
+        FlightPhase::LANDING, EventType::NONE, "LANDING: Landing finished?", true},
+
+    // Nothing leaves CRASHED, the plugin starts again from INIT when the next flight is created
+};
+
+struct PhaseStep
+{
+    FlightPhase phase;
+    EventType event = EventType::NONE;
+    const char* message = nullptr;
+    bool reportForces = false;
+
+    bool phaseChanged = false;
+
+    // The parking brake or wheels changed, which is always worth recording
+    bool inputChanged = false;
+};
+
+// Works out the flight phase from a stream of inputs. Doesn't allocate or touch X-Plane so it's
+// the same whether it's running in the sim or over stored states.
+class PhaseMachine
+{
+    PhaseThresholds m_thresholds;
+    FlightPhase m_phase = FlightPhase::INIT;
+    PhaseInput m_previous;
+
+ public:
+    constexpr PhaseMachine() = default;
+    constexpr explicit PhaseMachine(const PhaseThresholds& thresholds) : m_thresholds(thresholds) {}
+
+    constexpr void reset(FlightPhase phase = FlightPhase::INIT)
+    {
+        m_phase = phase;
+        m_previous = PhaseInput();
+    }
+
+    [[nodiscard]] constexpr FlightPhase getPhase() const { return m_phase; }
+    [[nodiscard]] constexpr const PhaseThresholds& getThresholds() const { return m_thresholds; }
+
+    constexpr PhaseStep update(const PhaseInput& input)
+    {
+        PhaseStep step;
+        step.phase = m_phase;
+        step.inputChanged =
+            input.parkingBrake != m_previous.parkingBrake ||
+            input.anyOnGround != m_previous.anyOnGround ||
+            input.allOnGround != m_previous.allOnGround;
+
+        for (const PhaseTransition& transition : PHASE_TRANSITIONS)
+        {
+            if (transition.from == m_phase && transition.condition(input, m_previous, m_thresholds))
+            {
+                step.phase = transition.to;
+                step.event = transition.event;
+                step.message = transition.message;
+                step.reportForces = transition.reportForces;
+                step.phaseChanged = transition.to != m_phase;
+                m_phase = transition.to;
+                break;
+            }
+        }
+
+        m_previous = input;
+        return step;
+    }
+};
+
+static_assert(
+    []
+    {
+        PhaseMachine machine;
+        return machine.update(PhaseInput()).phase == FlightPhase::PARKED &&
+            machine.update(PhaseInput{.parkingBrake = false}).phase == FlightPhase::TAXI;
+    }(),
+    "The phase machine should be usable at compile time");
+
+// Runs the phase machine over a flight's states, updating their phases and events.
+// Returns how many states were changed.
+inline size_t reclassify(std::span<State> states, const PhaseThresholds& thresholds = PhaseThresholds())
+{
+    PhaseMachine machine(thresholds);
+    size_t changed = 0;
+    for (State& state : states)
+    {
+        FlightPhase phase;
+        EventType event;
+        if (state.eventType == EventType::CRASH)
+        {
+            // Crashes come from X-Plane, not from anything we can see in the state
+            machine.reset(FlightPhase::CRASHED);
+            phase = FlightPhase::CRASHED;
+            event = EventType::CRASH;
+        }
+        else
+        {
+            PhaseStep step = machine.update(PhaseInput::fromState(state));
+            phase = step.phase;
+            event = step.event;
+        }
+
+        if (phase != state.flightPhase || event != state.eventType)
+        {
+            state.flightPhase = phase;
+            state.eventType = event;
+            changed++;
+        }
+    }
+    return changed;
+}
+
+#endif //BLACKBOX_PHASES_H
@@ -0,0 +1,50 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_PROFILE_H
+#define BLACKBOX_PROFILE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class ProfileSeries
+{
+    ALTITUDE,
+    AGL,
+    FPM,
+    INDICATED_AIR_SPEED,
+    GROUND_SPEED
+};
+
+constexpr int PROFILE_SERIES_COUNT = 5;
+
+const char* getProfileSeriesName(ProfileSeries series);
+
+// Everything a flight's charts need, as one array per value so drawing one of them doesn't drag
+// the rest through the cache
+struct Profile
+{
+    std::vector<uint64_t> timestamps;
+    std::array<std::vector<float>, PROFILE_SERIES_COUNT> values;
+
+    [[nodiscard]] size_t size() const { return timestamps.size(); }
+    [[nodiscard]] bool empty() const { return timestamps.empty(); }
+
+    [[nodiscard]] const std::vector<float>& get(ProfileSeries series) const { return values[static_cast<int>(series)]; }
+    std::vector<float>& get(ProfileSeries series) { return values[static_cast<int>(series)]; }
+
+    // Splits start to end in to buckets columns and finds the lowest and highest value in each, which is
+    // all that can be seen once there's more than a sample per pixel. Empty buckets are NaN.
+    void decimate(
+        ProfileSeries series,
+        uint64_t start,
+        uint64_t end,
+        int buckets,
+        float* minimums,
+        float* maximums) const;
+};
+
+#endif //BLACKBOX_PROFILE_H
@@ -0,0 +1,41 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_PURGER_H
+#define BLACKBOX_PURGER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "datastore.h"
+#include "logger.h"
+
+// Removes deleted flights in the background on its own connection. Each transaction only removes a
+// small batch of states, so the plugin's writer never has to wait long for the write lock. Once
+// everything's gone, the free space is given back if the database allows it.
+class Purger : BlackBox::Logger
+{
+    std::string m_dbPath;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_signal;
+    bool m_pending = false;
+    bool m_stopping = false;
+
+    void run();
+    bool purge(DataStore& dataStore);
+    [[nodiscard]] bool isStopping();
+
+ public:
+    explicit Purger(std::string dbPath);
+    ~Purger() override;
+
+    // Starts on anything that's been deleted
+    void wake();
+};
+
+#endif //BLACKBOX_PURGER_H
@@ -0,0 +1,70 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_REANALYSER_H
+#define BLACKBOX_REANALYSER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include "datastore.h"
+#include "logger.h"
+#include "phases.h"
+
+struct ReanalyseResult
+{
+    bool success = true;
+    size_t flights = 0;
+    size_t states = 0;
+    size_t changed = 0;
+    double seconds = 0.0;
+
+    [[nodiscard]] double getFlightsPerSecond() const
+    {
+        return seconds > 0.0 ? static_cast<double>(flights) / seconds : 0.0;
+    }
+};
+
+// Re-runs phase and event detection over every stored flight, apart from one that may still be
+// recording. Flights are classified in parallel, each worker has its own read connection, and the
+// results are written back from the calling thread in large transactions.
+class Reanalyser : BlackBox::Logger
+{
+    std::string m_dbPath;
+    PhaseThresholds m_thresholds;
+    unsigned int m_threads;
+
+    std::vector<uint64_t> m_flightIds;
+    std::atomic<size_t> m_nextFlight = 0;
+    std::atomic<size_t> m_flightsDone = 0;
+    std::atomic<size_t> m_states = 0;
+
+    // States whose phase or event have changed, waiting to be written
+    std::vector<std::pair<uint64_t, State>> m_pending;
+    // Summaries of the flights those states belong to, as landings may have moved
+    std::vector<std::pair<uint64_t, FlightSummary>> m_pendingSummaries;
+    unsigned int m_runningWorkers = 0;
+    bool m_cancelled = false;
+    std::mutex m_mutex;
+    std::condition_variable m_pendingSignal;
+    std::condition_variable m_spaceSignal;
+
+    void worker();
+    bool writePending(
+        DataStore& dataStore,
+        const std::vector<std::pair<uint64_t, State>>& changes,
+        const std::vector<std::pair<uint64_t, FlightSummary>>& summaries);
+
+ public:
+    // threads = 0 uses one per core
+    explicit Reanalyser(std::string dbPath, const PhaseThresholds& thresholds = PhaseThresholds(), unsigned int threads = 0);
+    ~Reanalyser() override = default;
+
+    // Called from the calling thread with how many flights have been done
+    ReanalyseResult run(const std::function<void(size_t done, size_t total)>& progress = nullptr);
+};
+
+#endif //BLACKBOX_REANALYSER_H
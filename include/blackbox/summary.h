@@ -0,0 +1,49 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_SUMMARY_H
+#define BLACKBOX_SUMMARY_H
+
+#include <cstdint>
+#include <span>
+
+#include "state.h"
+
+// Totals for a flight, kept up to date as states are written so nothing has to scan them all
+struct FlightSummary
+{
+    uint64_t samples = 0;
+    uint64_t startTime = 0;
+    uint64_t endTime = 0;
+
+    double distance = 0.0; // Kilometres
+    float maxAltitude = 0.0f;
+    uint64_t airborneTime = 0; // Milliseconds
+
+    // From the most recent landing
+    bool landed = false;
+    float touchdownFPM = 0.0f;
+
+    double minLatitude = 0.0;
+    double maxLatitude = 0.0;
+    double minLongitude = 0.0;
+    double maxLongitude = 0.0;
+
+    // Where the last state left off, so more can be added later
+    UFC::Coordinate lastPosition;
+    bool lastAirborne = false;
+
+    void add(const State& state);
+
+    // Same as adding each in turn, but measures the track in one go
+    void add(std::span<const State> states);
+
+    [[nodiscard]] uint64_t getDuration() const { return endTime - startTime; }
+
+ private:
+    // Everything but the distance. Returns true if the track continues from lastPosition to state.
+    bool extend(const State& state);
+};
+
+#endif //BLACKBOX_SUMMARY_H
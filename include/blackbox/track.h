@@ -0,0 +1,151 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_TRACK_H
+#define BLACKBOX_TRACK_H
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include "geo.h"
+
+// The points of a flight as separate arrays, so loops over one thing (drawing, projecting, finding the
+// highest point) only touch what they need and can be vectorised. Real = float halves the memory,
+// which is plenty for drawing as the projected positions are kept relative to the first one.
+template <typename Real = float>
+class Track
+{
+    std::vector<Real> m_latitudes;
+    std::vector<Real> m_longitudes;
+    std::vector<Real> m_altitudes;  // Feet
+    std::vector<Real> m_headings;
+    std::vector<Real> m_distances;  // Kilometres from the start
+
+    // Relative to the origin, filled in by whoever knows the projection
+    std::vector<Real> m_projectedX;
+    std::vector<Real> m_projectedY;
+    double m_originX = 0.0;
+    double m_originY = 0.0;
+
+    GeoBounds m_bounds;
+    float m_maxAltitude = 0.0f;
+
+    // Kept at full precision so it doesn't drift over a long flight
+    double m_distance = 0.0;
+    double m_lastLatitude = 0.0;
+    double m_lastLongitude = 0.0;
+
+ public:
+    static constexpr size_t BYTES_PER_POINT = sizeof(Real) * 7;
+
+    [[nodiscard]] size_t size() const { return m_latitudes.size(); }
+    [[nodiscard]] bool empty() const { return m_latitudes.empty(); }
+
+    void reserve(size_t count)
+    {
+        for (auto* array : {&m_latitudes, &m_longitudes, &m_altitudes, &m_headings, &m_distances, &m_projectedX, &m_projectedY})
+        {
+            array->reserve(count);
+        }
+    }
+
+    void clear()
+    {
+        *this = Track();
+    }
+
+    // Adds count points on to the end. Distances are measured from the last point already in the track.
+    void append(const double* latitudes, const double* longitudes, const float* altitudes, const float* headings, size_t count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        // Measure from where we left off
+        std::vector<double> legLatitudes;
+        std::vector<double> legLongitudes;
+        legLatitudes.reserve(count + 1);
+        legLongitudes.reserve(count + 1);
+        if (!empty())
+        {
+            legLatitudes.push_back(m_lastLatitude);
+            legLongitudes.push_back(m_lastLongitude);
+        }
+        legLatitudes.insert(legLatitudes.end(), latitudes, latitudes + count);
+        legLongitudes.insert(legLongitudes.end(), longitudes, longitudes + count);
+        std::vector<double> cumulative(legLatitudes.size());
+        trackDistance(legLatitudes.data(), legLongitudes.data(), legLatitudes.size(), nullptr, cumulative.data());
+        const size_t offset = legLatitudes.size() - count;
+        const double start = m_distance;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            m_latitudes.push_back(static_cast<Real>(latitudes[i]));
+            m_longitudes.push_back(static_cast<Real>(longitudes[i]));
+            m_altitudes.push_back(static_cast<Real>(altitudes[i]));
+            m_headings.push_back(static_cast<Real>(headings[i]));
+            m_distances.push_back(static_cast<Real>(start + cumulative[offset + i]));
+            m_projectedX.push_back(0);
+            m_projectedY.push_back(0);
+
+            m_bounds.add(latitudes[i], longitudes[i]);
+            m_maxAltitude = std::max(m_maxAltitude, altitudes[i]);
+        }
+
+        m_distance = start + cumulative.back();
+        m_lastLatitude = latitudes[count - 1];
+        m_lastLongitude = longitudes[count - 1];
+    }
+
+    [[nodiscard]] double getLatitude(size_t i) const { return m_latitudes[i]; }
+    [[nodiscard]] double getLongitude(size_t i) const { return m_longitudes[i]; }
+    [[nodiscard]] float getAltitude(size_t i) const { return static_cast<float>(m_altitudes[i]); }
+    [[nodiscard]] float getHeading(size_t i) const { return static_cast<float>(m_headings[i]); }
+    [[nodiscard]] double getDistance(size_t i) const { return m_distances[i]; }
+
+    // For tight loops
+    [[nodiscard]] const Real* getLatitudes() const { return m_latitudes.data(); }
+    [[nodiscard]] const Real* getLongitudes() const { return m_longitudes.data(); }
+    [[nodiscard]] const Real* getAltitudes() const { return m_altitudes.data(); }
+    [[nodiscard]] const Real* getHeadings() const { return m_headings.data(); }
+    [[nodiscard]] const Real* getDistances() const { return m_distances.data(); }
+    [[nodiscard]] const Real* getProjectedX() const { return m_projectedX.data(); }
+    [[nodiscard]] const Real* getProjectedY() const { return m_projectedY.data(); }
+    Real* getProjectedX() { return m_projectedX.data(); }
+    Real* getProjectedY() { return m_projectedY.data(); }
+
+    [[nodiscard]] const GeoBounds& getBounds() const { return m_bounds; }
+    [[nodiscard]] float getMaxAltitude() const { return m_maxAltitude; }
+    [[nodiscard]] double getTotalDistance() const { return m_distance; }
+
+    // Projected positions are stored relative to this, set it before filling them in
+    void setProjectionOrigin(double x, double y)
+    {
+        m_originX = x;
+        m_originY = y;
+    }
+    [[nodiscard]] double getOriginX() const { return m_originX; }
+    [[nodiscard]] double getOriginY() const { return m_originY; }
+
+    void setProjected(size_t i, double x, double y)
+    {
+        m_projectedX[i] = static_cast<Real>(x - m_originX);
+        m_projectedY[i] = static_cast<Real>(y - m_originY);
+    }
+    // count points starting at from
+    void setProjected(size_t from, const double* x, const double* y, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            m_projectedX[from + i] = static_cast<Real>(x[i] - m_originX);
+            m_projectedY[from + i] = static_cast<Real>(y[i] - m_originY);
+        }
+    }
+    [[nodiscard]] double getProjectedX(size_t i) const { return m_originX + m_projectedX[i]; }
+    [[nodiscard]] double getProjectedY(size_t i) const { return m_originY + m_projectedY[i]; }
+};
+
+#endif //BLACKBOX_TRACK_H
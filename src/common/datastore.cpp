@@ -5,9 +5,112 @@
 
 #include "blackbox/datastore.h"
 
+#include <chrono>
+#include <cinttypes>
+
 using namespace std;
 using namespace BlackBox;
 
+// Each entry moves the schema on by one version, tracked with PRAGMA user_version.
+// Only ever add to the end of this!
+static const char* MIGRATIONS[] = {
+    // 1: Keep what the phases were worked out from, so they can be worked out again
+    "ALTER TABLE flight_state ADD COLUMN parking_brake INTEGER;"
+    "ALTER TABLE flight_state ADD COLUMN any_on_ground INTEGER;"
+    "ALTER TABLE flight_state ADD COLUMN all_on_ground INTEGER;",
+
+    // 2: Per flight totals, kept up to date by the writer. Filled in for old flights by backfillSummaries()
+    "CREATE TABLE flight_summary ("
+    "    flight_id INTEGER PRIMARY KEY,"
+    "    samples INTEGER,"
+    "    first_timestamp INTEGER,"
+    "    last_timestamp INTEGER,"
+    "    distance REAL,"
+    "    max_altitude REAL,"
+    "    airborne_time INTEGER,"
+    "    landed INTEGER,"
+    "    touchdown_fpm REAL,"
+    "    min_latitude REAL,"
+    "    max_latitude REAL,"
+    "    min_longitude REAL,"
+    "    max_longitude REAL,"
+    "    last_latitude REAL,"
+    "    last_longitude REAL,"
+    "    last_altitude REAL,"
+    "    last_airborne INTEGER"
+    ");",
+
+    // 3: Find a moment in a flight without reading all of it. Covers everything the old index did.
+    "CREATE INDEX IF NOT EXISTS flight_state_by_time ON flight_state (flight_id, timestamp);"
+    "DROP INDEX IF EXISTS flight_state_by_id;",
+
+    // 4: Full text search over the flights, kept in step by triggers
+    "CREATE VIRTUAL TABLE flight_search USING fts5("
+    "    origin, destination, aircraft_type, flight_code,"
+    "    content='flights', content_rowid='id', prefix='2 3'"
+    ");"
+    "CREATE TRIGGER flights_search_insert AFTER INSERT ON flights BEGIN"
+    "    INSERT INTO flight_search (rowid, origin, destination, aircraft_type, flight_code)"
+    "      VALUES (new.id, new.origin, new.destination, new.aircraft_type, new.flight_code);"
+    "END;"
+    "CREATE TRIGGER flights_search_delete AFTER DELETE ON flights BEGIN"
+    "    INSERT INTO flight_search (flight_search, rowid, origin, destination, aircraft_type, flight_code)"
+    "      VALUES ('delete', old.id, old.origin, old.destination, old.aircraft_type, old.flight_code);"
+    "END;"
+    "CREATE TRIGGER flights_search_update AFTER UPDATE ON flights BEGIN"
+    "    INSERT INTO flight_search (flight_search, rowid, origin, destination, aircraft_type, flight_code)"
+    "      VALUES ('delete', old.id, old.origin, old.destination, old.aircraft_type, old.flight_code);"
+    "    INSERT INTO flight_search (rowid, origin, destination, aircraft_type, flight_code)"
+    "      VALUES (new.id, new.origin, new.destination, new.aircraft_type, new.flight_code);"
+    "END;"
+    "INSERT INTO flight_search (flight_search) VALUES ('rebuild');"
+    "CREATE INDEX IF NOT EXISTS flights_by_start_time ON flights (start_time);"
+    "CREATE INDEX IF NOT EXISTS flights_by_aircraft_type ON flights (aircraft_type, start_time);",
+
+    // 5: Deleted flights are hidden straight away and their states removed a bit at a time by purgeFlight()
+    "ALTER TABLE flights ADD COLUMN deleted INTEGER NOT NULL DEFAULT 0;"
+    "CREATE INDEX IF NOT EXISTS flights_deleted ON flights (id) WHERE deleted != 0;",
+};
+
+static const char* SUMMARY_COLUMNS =
+    "samples, first_timestamp, last_timestamp, distance, max_altitude, airborne_time, landed, touchdown_fpm,"
+    " min_latitude, max_latitude, min_longitude, max_longitude,"
+    " last_latitude, last_longitude, last_altitude, last_airborne";
+
+// Reads SUMMARY_COLUMNS starting at col. Returns false if there's no summary.
+static bool readSummary(sqlite3_stmt* stmt, int col, FlightSummary& summary)
+{
+    if (sqlite3_column_type(stmt, col) == SQLITE_NULL)
+    {
+        return false;
+    }
+    summary.samples = sqlite3_column_int64(stmt, col++);
+    summary.startTime = sqlite3_column_int64(stmt, col++);
+    summary.endTime = sqlite3_column_int64(stmt, col++);
+    summary.distance = sqlite3_column_double(stmt, col++);
+    summary.maxAltitude = sqlite3_column_double(stmt, col++);
+    summary.airborneTime = sqlite3_column_int64(stmt, col++);
+    summary.landed = sqlite3_column_int(stmt, col++);
+    summary.touchdownFPM = sqlite3_column_double(stmt, col++);
+    summary.minLatitude = sqlite3_column_double(stmt, col++);
+    summary.maxLatitude = sqlite3_column_double(stmt, col++);
+    summary.minLongitude = sqlite3_column_double(stmt, col++);
+    summary.maxLongitude = sqlite3_column_double(stmt, col++);
+    summary.lastPosition.latitude = sqlite3_column_double(stmt, col++);
+    summary.lastPosition.longitude = sqlite3_column_double(stmt, col++);
+    summary.lastPosition.altitude = sqlite3_column_double(stmt, col++);
+    summary.lastAirborne = sqlite3_column_int(stmt, col);
+    return true;
+}
+
+// States from before the wheels were recorded
+constexpr float ON_GROUND_AGL = 10.0f;
+
+constexpr int BUSY_TIMEOUT_MS = 250;
+
+// Long enough for another connection to finish a migration, rebuilding the search index can take a while
+constexpr int MIGRATE_BUSY_TIMEOUT_MS = 60000;
+
 string getString(sqlite3_stmt* stmt, int col)
 {
     const unsigned char* str = sqlite3_column_text(stmt, col);
@@ -18,6 +121,47 @@ string getString(sqlite3_stmt* stmt, int col)
     return string(reinterpret_cast<const char*>(str));
 }
 
+static const char* STATE_COLUMNS =
+    "phase, event, timestamp, latitude, longitude, altitude, agl, fpm, fpm_average, pitch, yaw, roll,"
+    " ground_speed, indicated_air_speed, parking_brake, any_on_ground, all_on_ground, id";
+
+// Reads STATE_COLUMNS, returns the state's row id
+static uint64_t readState(sqlite3_stmt* stmt, State& state)
+{
+    string phase = getString(stmt, 0);
+    state.setPhase(phase);
+    string event = getString(stmt, 1);
+    state.setEventType(event);
+
+    state.timestamp = sqlite3_column_int64(stmt, 2);
+
+    state.position.latitude = sqlite3_column_double(stmt, 3);
+    state.position.longitude = sqlite3_column_double(stmt, 4);
+    state.position.altitude = sqlite3_column_double(stmt, 5);
+    state.agl = sqlite3_column_double(stmt, 6);
+    state.fpm = sqlite3_column_double(stmt, 7);
+    state.fpmAverage = sqlite3_column_double(stmt, 8);
+    state.pitch = sqlite3_column_double(stmt, 9);
+    state.yaw = sqlite3_column_double(stmt, 10);
+    state.roll = sqlite3_column_double(stmt, 11);
+    state.groundSpeed = sqlite3_column_double(stmt, 12);
+    state.indicatedAirSpeed = sqlite3_column_double(stmt, 13);
+    if (sqlite3_column_type(stmt, 14) != SQLITE_NULL)
+    {
+        state.parkingBrake = sqlite3_column_int(stmt, 14);
+        state.anyOnGround = sqlite3_column_int(stmt, 15);
+        state.allOnGround = sqlite3_column_int(stmt, 16);
+    }
+    else
+    {
+        // Recorded before these were stored, so make a best guess
+        state.parkingBrake = state.flightPhase == FlightPhase::PARKED;
+        state.anyOnGround = state.agl < ON_GROUND_AGL;
+        state.allOnGround = state.anyOnGround;
+    }
+    return sqlite3_column_int64(stmt, 17);
+}
+
 DataStore::DataStore() : Logger("DataStore")
 {
 }
@@ -32,6 +176,26 @@ DataStore::~DataStore()
     {
         sqlite3_finalize(m_fetchStatusStatement);
     }
+    if (m_updatePhaseStatement != nullptr)
+    {
+        sqlite3_finalize(m_updatePhaseStatement);
+    }
+    if (m_writeSummaryStatement != nullptr)
+    {
+        sqlite3_finalize(m_writeSummaryStatement);
+    }
+    if (m_fetchWindowStatement != nullptr)
+    {
+        sqlite3_finalize(m_fetchWindowStatement);
+    }
+    if (m_dataVersionStatement != nullptr)
+    {
+        sqlite3_finalize(m_dataVersionStatement);
+    }
+    if (m_fetchStateAtStatement != nullptr)
+    {
+        sqlite3_finalize(m_fetchStateAtStatement);
+    }
 
     if (m_db != nullptr)
     {
@@ -41,6 +205,7 @@ DataStore::~DataStore()
 
 bool DataStore::init(string dbPath)
 {
+    m_path = dbPath;
     int res = sqlite3_open(dbPath.c_str(), &m_db);
     if (res != SQLITE_OK)
     {
@@ -48,9 +213,22 @@ bool DataStore::init(string dbPath)
         return false;
     }
 
+    // Another connection may be part way through setting up or migrating the schema. Once
+    // that's done, don't wait long, callers are expected to retry.
+    sqlite3_busy_timeout(m_db, MIGRATE_BUSY_TIMEOUT_MS);
+
     string sql;
     char* err;
 
+    // Lets reclaimSpace() give space back a bit at a time. Only takes effect when the database is new.
+    sql = "PRAGMA auto_vacuum=INCREMENTAL";
+    res = sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &err);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "init: Failed to set auto vacuum: %s", err);
+        return false;
+    }
+
     // Make sure Write Ahead Logging is enabled
     sql = "PRAGMA journal_mode=WAL";
     sqlite3_stmt *stmt;
@@ -68,6 +246,40 @@ bool DataStore::init(string dbPath)
     }
     sqlite3_finalize(stmt);
 
+    // With WAL, NORMAL only syncs at checkpoints which is still safe against corruption
+    sql = "PRAGMA synchronous=NORMAL";
+    res = sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &err);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "init: Failed to set synchronous mode: %s", err);
+        return false;
+    }
+
+    // Don't let the WAL file stay at its high water mark after a checkpoint
+    sql = "PRAGMA journal_size_limit=67108864";
+    res = sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &err);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "init: Failed to set journal size limit: %s", err);
+        return false;
+    }
+
+    sql = "PRAGMA page_size";
+    res = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &stmt, nullptr);
+    if (res == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            m_pageSize = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // Disable automatic checkpoints, they would otherwise run inside whichever commit crosses
+    // the 1000 page threshold. Checkpoints are scheduled by calling checkpoint() instead.
+    // Note that this replaces the automatic checkpoint hook.
+    sqlite3_wal_hook(m_db, walHook, this);
+
     sql =
         "CREATE TABLE IF NOT EXISTS flights ("
         "    id INTEGER PRIMARY KEY,"
@@ -110,7 +322,7 @@ bool DataStore::init(string dbPath)
         return false;
     }
 
-    sql = "CREATE INDEX IF NOT EXISTS flight_state_by_id ON flight_state (flight_id)";
+    sql = "CREATE INDEX IF NOT EXISTS flight_state_by_time ON flight_state (flight_id, timestamp)";
     res = sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &err);
     if (res != SQLITE_OK)
     {
@@ -118,12 +330,18 @@ bool DataStore::init(string dbPath)
         return false;
     }
 
+    if (!migrate())
+    {
+        return false;
+    }
+    sqlite3_busy_timeout(m_db, BUSY_TIMEOUT_MS);
+
     sql =
         "INSERT"
         "  INTO flight_state"
-        "    (id, flight_id, phase, event, timestamp, latitude, longitude, altitude, agl, fpm, fpm_average, pitch, yaw, roll, ground_speed, indicated_air_speed)"
+        "    (id, flight_id, phase, event, timestamp, latitude, longitude, altitude, agl, fpm, fpm_average, pitch, yaw, roll, ground_speed, indicated_air_speed, parking_brake, any_on_ground, all_on_ground)"
         "  VALUES"
-        "    (NULL, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        "    (NULL, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
     res = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &m_writeStatusStatement, nullptr);
     if (res != SQLITE_OK)
     {
@@ -131,22 +349,7 @@ bool DataStore::init(string dbPath)
         return false;
     }
 
-    sql =
-        "SELECT"
-        "    phase,"
-        "    event,"
-        "    timestamp,"
-        "    latitude,"
-        "    longitude,"
-        "    altitude,"
-        "    agl,"
-        "    fpm,"
-        "    fpm_average,"
-        "    pitch,"
-        "    yaw,"
-        "    roll,"
-        "    ground_speed,"
-        "    indicated_air_speed"
+    sql = string("SELECT ") + STATE_COLUMNS +
         "  FROM flight_state"
         "  WHERE flight_id=? AND timestamp > ?"
         "  ORDER BY timestamp ASC";
@@ -157,10 +360,92 @@ bool DataStore::init(string dbPath)
         return false;
     }
 
+    sql = string("SELECT ") + STATE_COLUMNS +
+        "  FROM flight_state"
+        "  WHERE flight_id=? AND timestamp BETWEEN ? AND ?"
+        "  ORDER BY timestamp ASC";
+    res = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &m_fetchWindowStatement, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "init: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return false;
+    }
+
+    sql = string("SELECT ") + STATE_COLUMNS +
+        "  FROM flight_state"
+        "  WHERE flight_id=? AND timestamp <= ?"
+        "  ORDER BY timestamp DESC"
+        "  LIMIT 1";
+    res = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &m_fetchStateAtStatement, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "init: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return false;
+    }
+
+    res = sqlite3_prepare_v2(m_db, "PRAGMA data_version", -1, &m_dataVersionStatement, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "init: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return false;
+    }
+
 
     return true;
 }
 
+bool DataStore::migrate()
+{
+    int latest = static_cast<int>(size(MIGRATIONS));
+    while (true)
+    {
+        // The UI and the plugin may both be starting, so take the write lock before looking at
+        // the version. Whoever gets it second sees what the first did.
+        int res = startTransaction();
+        if (res != SQLITE_OK)
+        {
+            return false;
+        }
+
+        int version = 0;
+        sqlite3_stmt* stmt;
+        res = sqlite3_prepare_v2(m_db, "PRAGMA user_version", -1, &stmt, nullptr);
+        if (res != SQLITE_OK)
+        {
+            log(ERROR, "migrate: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+            rollbackTransaction();
+            return false;
+        }
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+
+        if (version >= latest)
+        {
+            return commitTransaction() == SQLITE_OK;
+        }
+
+        log(INFO, "migrate: Updating database to version %d", version + 1);
+
+        // Each migration and its version change either happen together or not at all
+        string sql = MIGRATIONS[version];
+        sql += "PRAGMA user_version=" + to_string(version + 1) + ";";
+        sql += "COMMIT;";
+
+        char* err;
+        res = sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &err);
+        if (res != SQLITE_OK)
+        {
+            log(ERROR, "migrate: Failed to update database to version %d: %s", version + 1, err);
+            sqlite3_free(err);
+            rollbackTransaction();
+            return false;
+        }
+    }
+}
+
 uint64_t DataStore::createFlight(Flight& flight)
 {
     const string sql =
@@ -218,9 +503,14 @@ void DataStore::updateFlight(const Flight& flight)
 }
 
 
-std::vector<Flight> DataStore::fetchFlights()
+std::vector<Flight> DataStore::fetchFlights(uint64_t fromId)
 {
-    string sql = "SELECT id, origin, destination, aircraft_type, flight_code, start_time FROM flights ORDER BY id ASC";
+    string sql =
+        string("SELECT id, origin, destination, aircraft_type, flight_code, start_time, ") + SUMMARY_COLUMNS +
+        "  FROM flights"
+        "  LEFT JOIN flight_summary ON flight_summary.flight_id = flights.id"
+        "  WHERE id >= ? AND deleted = 0"
+        "  ORDER BY id ASC";
     vector<Flight> flights;
     sqlite3_stmt* stmt;
     int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
@@ -229,6 +519,7 @@ std::vector<Flight> DataStore::fetchFlights()
         log(ERROR, "fetchFlights: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
         return flights;
     }
+    sqlite3_bind_int64(stmt, 1, fromId);
     while (true)
     {
         int s;
@@ -242,6 +533,7 @@ std::vector<Flight> DataStore::fetchFlights()
             flight.icaoType = getString(stmt, 3);
             flight.flightId = getString(stmt, 4);
             flight.startTime = sqlite3_column_int64(stmt, 5);
+            readSummary(stmt, 6, flight.summary);
             flights.push_back(flight);
         }
         else if (s == SQLITE_DONE)
@@ -253,7 +545,105 @@ std::vector<Flight> DataStore::fetchFlights()
     return flights;
 }
 
-void DataStore::writeState(uint64_t flightId, const State &state)
+// Every word has to match the start of a word in one of the columns
+static string toMatchExpression(const string& text)
+{
+    string expression;
+    size_t pos = 0;
+    while (pos < text.length())
+    {
+        size_t start = text.find_first_not_of(" \t", pos);
+        if (start == string::npos)
+        {
+            break;
+        }
+        size_t end = text.find_first_of(" \t", start);
+        if (end == string::npos)
+        {
+            end = text.length();
+        }
+
+        // Quoted so that FTS5 doesn't see any operators or punctuation in it
+        if (!expression.empty())
+        {
+            expression += " ";
+        }
+        expression += "\"";
+        for (size_t i = start; i < end; i++)
+        {
+            if (text[i] == '"')
+            {
+                expression += '"';
+            }
+            expression += text[i];
+        }
+        expression += "\"*";
+        pos = end;
+    }
+    return expression;
+}
+
+vector<uint64_t> DataStore::searchFlights(const FlightQuery& query)
+{
+    vector<uint64_t> flightIds;
+
+    string match = toMatchExpression(query.text);
+    string sql = "SELECT id FROM flights WHERE deleted = 0";
+    if (!match.empty())
+    {
+        sql += " AND id IN (SELECT rowid FROM flight_search WHERE flight_search MATCH :match)";
+    }
+    if (query.fromTime != 0)
+    {
+        sql += " AND start_time >= :from";
+    }
+    if (query.toTime != 0)
+    {
+        sql += " AND start_time < :to";
+    }
+    if (!query.aircraftType.empty())
+    {
+        sql += " AND aircraft_type = :type";
+    }
+    sql += " ORDER BY id ASC";
+
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "searchFlights: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return flightIds;
+    }
+    if (!match.empty())
+    {
+        sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":match"), match.c_str(), -1, SQLITE_STATIC);
+    }
+    if (query.fromTime != 0)
+    {
+        sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":from"), query.fromTime);
+    }
+    if (query.toTime != 0)
+    {
+        sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":to"), query.toTime);
+    }
+    if (!query.aircraftType.empty())
+    {
+        sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":type"), query.aircraftType.c_str(), -1, SQLITE_STATIC);
+    }
+
+    while ((res = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        flightIds.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    if (res != SQLITE_DONE)
+    {
+        log(ERROR, "searchFlights: Failed to search flights: %d: %s", res, sqlite3_errmsg(m_db));
+    }
+    return flightIds;
+}
+
+int DataStore::writeState(uint64_t flightId, const State &state)
 {
     string phaseString = state.getPhaseString();
     string eventString = state.getEventString();
@@ -272,16 +662,20 @@ void DataStore::writeState(uint64_t flightId, const State &state)
     sqlite3_bind_double(m_writeStatusStatement, 13, state.roll);
     sqlite3_bind_double(m_writeStatusStatement, 14, state.groundSpeed);
     sqlite3_bind_double(m_writeStatusStatement, 15, state.indicatedAirSpeed);
+    sqlite3_bind_int(m_writeStatusStatement, 16, state.parkingBrake);
+    sqlite3_bind_int(m_writeStatusStatement, 17, state.anyOnGround);
+    sqlite3_bind_int(m_writeStatusStatement, 18, state.allOnGround);
     int res = sqlite3_step(m_writeStatusStatement);
+    sqlite3_reset(m_writeStatusStatement);
     if (res != SQLITE_DONE)
     {
         log(ERROR, "write: Failed to insert state: %d: %s", res, sqlite3_errmsg(m_db));
-        return;
+        return res;
     }
-    sqlite3_reset(m_writeStatusStatement);
+    return SQLITE_OK;
 }
 
-std::vector<State> DataStore::fetchUpdates(uint64_t flightId, uint64_t sinceTimestamp)
+std::vector<State> DataStore::fetchUpdates(uint64_t flightId, uint64_t sinceTimestamp, vector<uint64_t>* stateIds)
 {
 
     vector<State> states;
@@ -295,25 +689,13 @@ std::vector<State> DataStore::fetchUpdates(uint64_t flightId, uint64_t sinceTime
         if (s == SQLITE_ROW)
         {
             State state;
-            string phase = getString(m_fetchStatusStatement, 0);
-            state.setPhase(phase);
-            string event = getString(m_fetchStatusStatement, 1);
-            state.setEventType(event);
-
-            state.timestamp = sqlite3_column_int64(m_fetchStatusStatement, 2);
-
-            state.position.latitude = sqlite3_column_double(m_fetchStatusStatement, 3);
-            state.position.longitude = sqlite3_column_double(m_fetchStatusStatement, 4);
-            state.position.altitude = sqlite3_column_double(m_fetchStatusStatement, 5);
-            state.agl = sqlite3_column_double(m_fetchStatusStatement, 6);
-            state.fpm = sqlite3_column_double(m_fetchStatusStatement, 7);
-            state.fpmAverage = sqlite3_column_double(m_fetchStatusStatement, 8);
-            state.pitch = sqlite3_column_double(m_fetchStatusStatement, 9);
-            state.yaw = sqlite3_column_double(m_fetchStatusStatement, 10);
-            state.roll = sqlite3_column_double(m_fetchStatusStatement, 11);
-            state.groundSpeed = sqlite3_column_double(m_fetchStatusStatement, 12);
-            state.indicatedAirSpeed = sqlite3_column_double(m_fetchStatusStatement, 13);
+            uint64_t stateId = readState(m_fetchStatusStatement, state);
             states.push_back(state);
+
+            if (stateIds != nullptr)
+            {
+                stateIds->push_back(stateId);
+            }
         }
         else if (s == SQLITE_DONE)
         {
@@ -326,38 +708,495 @@ std::vector<State> DataStore::fetchUpdates(uint64_t flightId, uint64_t sinceTime
     return states;
 }
 
-void DataStore::startTransaction()
+vector<State> DataStore::fetchWindow(uint64_t flightId, uint64_t fromTimestamp, uint64_t toTimestamp)
 {
-    int res = sqlite3_exec(m_db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+    vector<State> states;
+
+    sqlite3_bind_int64(m_fetchWindowStatement, 1, flightId);
+    sqlite3_bind_int64(m_fetchWindowStatement, 2, fromTimestamp);
+    sqlite3_bind_int64(m_fetchWindowStatement, 3, toTimestamp);
+    while (sqlite3_step(m_fetchWindowStatement) == SQLITE_ROW)
+    {
+        State state;
+        readState(m_fetchWindowStatement, state);
+        states.push_back(state);
+    }
+    sqlite3_reset(m_fetchWindowStatement);
+    return states;
+}
+
+bool DataStore::fetchStateAt(uint64_t flightId, uint64_t timestamp, State& state)
+{
+    sqlite3_bind_int64(m_fetchStateAtStatement, 1, flightId);
+    sqlite3_bind_int64(m_fetchStateAtStatement, 2, timestamp);
+    bool found = sqlite3_step(m_fetchStateAtStatement) == SQLITE_ROW;
+    if (found)
+    {
+        readState(m_fetchStateAtStatement, state);
+    }
+    sqlite3_reset(m_fetchStateAtStatement);
+    return found;
+}
+
+bool DataStore::fetchProfile(uint64_t flightId, Profile& profile)
+{
+    string sql =
+        "SELECT timestamp, altitude, agl, fpm, indicated_air_speed, ground_speed"
+        "  FROM flight_state"
+        "  WHERE flight_id=?"
+        "  ORDER BY timestamp ASC";
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "fetchProfile: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, flightId);
+
+    profile = Profile();
+    while ((res = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        profile.timestamps.push_back(sqlite3_column_int64(stmt, 0));
+        for (int series = 0; series < PROFILE_SERIES_COUNT; series++)
+        {
+            profile.values[series].push_back(static_cast<float>(sqlite3_column_double(stmt, series + 1)));
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (res != SQLITE_DONE)
+    {
+        log(ERROR, "fetchProfile: Failed to read flight %" PRIu64 ": %d: %s", flightId, res, sqlite3_errmsg(m_db));
+        return false;
+    }
+    return true;
+}
+
+vector<uint64_t> DataStore::fetchTimestamps(uint64_t flightId, uint64_t sinceTimestamp)
+{
+    vector<uint64_t> timestamps;
+
+    string sql = "SELECT timestamp FROM flight_state WHERE flight_id=? AND timestamp >= ? ORDER BY timestamp ASC";
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "fetchTimestamps: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return timestamps;
+    }
+    sqlite3_bind_int64(stmt, 1, flightId);
+    sqlite3_bind_int64(stmt, 2, sinceTimestamp);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        timestamps.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return timestamps;
+}
+
+int DataStore::updatePhase(uint64_t stateId, const State& state)
+{
+    if (m_updatePhaseStatement == nullptr)
+    {
+        const string sql = "UPDATE flight_state SET phase=?, event=? WHERE id=?";
+        int res = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &m_updatePhaseStatement, nullptr);
+        if (res != SQLITE_OK)
+        {
+            log(ERROR, "updatePhase: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+            return res;
+        }
+    }
+
+    string phaseString = state.getPhaseString();
+    string eventString = state.getEventString();
+    sqlite3_bind_text(m_updatePhaseStatement, 1, phaseString.c_str(), phaseString.length(), SQLITE_STATIC);
+    sqlite3_bind_text(m_updatePhaseStatement, 2, eventString.c_str(), eventString.length(), SQLITE_STATIC);
+    sqlite3_bind_int64(m_updatePhaseStatement, 3, stateId);
+    int res = sqlite3_step(m_updatePhaseStatement);
+    sqlite3_reset(m_updatePhaseStatement);
+    if (res != SQLITE_DONE)
+    {
+        log(ERROR, "updatePhase: Failed to update state: %d: %s", res, sqlite3_errmsg(m_db));
+        return res;
+    }
+    return SQLITE_OK;
+}
+
+bool DataStore::fetchSummary(uint64_t flightId, FlightSummary& summary)
+{
+    string sql = string("SELECT ") + SUMMARY_COLUMNS + " FROM flight_summary WHERE flight_id=?";
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "fetchSummary: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, flightId);
+
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        found = readSummary(stmt, 0, summary);
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+int DataStore::writeSummary(uint64_t flightId, const FlightSummary& summary)
+{
+    if (m_writeSummaryStatement == nullptr)
+    {
+        string sql =
+            string("INSERT OR REPLACE INTO flight_summary (flight_id, ") + SUMMARY_COLUMNS + ")"
+            "  VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        int res = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &m_writeSummaryStatement, nullptr);
+        if (res != SQLITE_OK)
+        {
+            log(ERROR, "writeSummary: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+            return res;
+        }
+    }
+
+    sqlite3_stmt* stmt = m_writeSummaryStatement;
+    int col = 1;
+    sqlite3_bind_int64(stmt, col++, flightId);
+    sqlite3_bind_int64(stmt, col++, summary.samples);
+    sqlite3_bind_int64(stmt, col++, summary.startTime);
+    sqlite3_bind_int64(stmt, col++, summary.endTime);
+    sqlite3_bind_double(stmt, col++, summary.distance);
+    sqlite3_bind_double(stmt, col++, summary.maxAltitude);
+    sqlite3_bind_int64(stmt, col++, summary.airborneTime);
+    sqlite3_bind_int(stmt, col++, summary.landed);
+    sqlite3_bind_double(stmt, col++, summary.touchdownFPM);
+    sqlite3_bind_double(stmt, col++, summary.minLatitude);
+    sqlite3_bind_double(stmt, col++, summary.maxLatitude);
+    sqlite3_bind_double(stmt, col++, summary.minLongitude);
+    sqlite3_bind_double(stmt, col++, summary.maxLongitude);
+    sqlite3_bind_double(stmt, col++, summary.lastPosition.latitude);
+    sqlite3_bind_double(stmt, col++, summary.lastPosition.longitude);
+    sqlite3_bind_double(stmt, col++, summary.lastPosition.altitude);
+    sqlite3_bind_int(stmt, col, summary.lastAirborne);
+    int res = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (res != SQLITE_DONE)
+    {
+        log(ERROR, "writeSummary: Failed to write summary: %d: %s", res, sqlite3_errmsg(m_db));
+        return res;
+    }
+    return SQLITE_OK;
+}
+
+FlightSummary DataStore::summariseFlight(uint64_t flightId)
+{
+    FlightSummary summary;
+    summary.add(fetchUpdates(flightId, 0));
+    return summary;
+}
+
+int DataStore::backfillSummaries(size_t* summarised)
+{
+    vector<uint64_t> flightIds;
+    string sql = "SELECT id FROM flights WHERE deleted = 0 AND id NOT IN (SELECT flight_id FROM flight_summary)";
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "backfillSummaries: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return res;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        flightIds.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+
+    if (flightIds.empty())
+    {
+        return SQLITE_OK;
+    }
+
+    log(INFO, "backfillSummaries: Summarising %zu flights", flightIds.size());
+    for (uint64_t flightId : flightIds)
+    {
+        // One at a time so we don't hold the write lock for long
+        res = writeSummary(flightId, summariseFlight(flightId));
+        if (res != SQLITE_OK)
+        {
+            return res;
+        }
+        if (summarised != nullptr)
+        {
+            (*summarised)++;
+        }
+    }
+    return SQLITE_OK;
+}
+
+int DataStore::startTransaction()
+{
+    // Take the write lock now, while the busy timeout can still wait for it. A deferred transaction
+    // that's read anything can only fail if another connection commits before it gets to write.
+    int res = sqlite3_exec(m_db, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK)
     {
         log(ERROR, "startTransaction: Failed to start transaction: %d: %s", res, sqlite3_errmsg(m_db));
     }
+    return res;
 }
 
-void DataStore::commitTransaction()
+int DataStore::commitTransaction()
 {
     int res = sqlite3_exec(m_db, "COMMIT", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK)
     {
         log(ERROR, "commitTransaction: Failed to commit transaction: %d: %s", res, sqlite3_errmsg(m_db));
     }
+    return res;
+}
+
+void DataStore::rollbackTransaction()
+{
+    if (sqlite3_get_autocommit(m_db))
+    {
+        // SQLite has already rolled it back for us
+        return;
+    }
+    int res = sqlite3_exec(m_db, "ROLLBACK", nullptr, nullptr, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "rollbackTransaction: Failed to roll back transaction: %d: %s", res, sqlite3_errmsg(m_db));
+    }
+}
+
+int DataStore::setDurable(bool durable)
+{
+    // Can't be changed inside a transaction
+    const char* sql = durable ? "PRAGMA synchronous=FULL" : "PRAGMA synchronous=NORMAL";
+    int res = sqlite3_exec(m_db, sql, nullptr, nullptr, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "setDurable: Failed to set synchronous mode: %d: %s", res, sqlite3_errmsg(m_db));
+    }
+    return res;
+}
+
+int DataStore::walHook(void* arg, sqlite3* db, const char* dbName, int frames)
+{
+    auto dataStore = static_cast<DataStore*>(arg);
+    if (frames < dataStore->m_checkpointedFrames)
+    {
+        // The WAL has been restarted since the last checkpoint
+        dataStore->m_checkpointedFrames = 0;
+    }
+
+    int written = frames - dataStore->m_walFrames;
+    if (written < 0)
+    {
+        written = frames;
+    }
+    dataStore->m_bytesWritten += static_cast<uint64_t>(written) * dataStore->m_pageSize;
+    dataStore->m_walFrames = frames;
+    return SQLITE_OK;
+}
+
+uint64_t DataStore::getDataVersion()
+{
+    uint64_t version = 0;
+    int res = sqlite3_step(m_dataVersionStatement);
+    if (res == SQLITE_ROW)
+    {
+        version = sqlite3_column_int64(m_dataVersionStatement, 0);
+    }
+    else
+    {
+        log(ERROR, "getDataVersion: Failed to read data version: %d: %s", res, sqlite3_errmsg(m_db));
+    }
+    sqlite3_reset(m_dataVersionStatement);
+    return version;
+}
+
+uint64_t DataStore::getPendingWALSize() const
+{
+    int frames = m_walFrames - m_checkpointedFrames;
+    if (frames < 0)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(frames) * m_pageSize;
+}
+
+bool DataStore::checkpoint()
+{
+    int logFrames = 0;
+    int checkpointedFrames = 0;
+
+    auto startTime = chrono::steady_clock::now();
+    int res = sqlite3_wal_checkpoint_v2(m_db, nullptr, SQLITE_CHECKPOINT_PASSIVE, &logFrames, &checkpointedFrames);
+    auto duration = chrono::duration<float, milli>(chrono::steady_clock::now() - startTime);
+
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "checkpoint: Failed to checkpoint: %d: %s", res, sqlite3_errmsg(m_db));
+        return false;
+    }
+
+    m_walFrames = logFrames;
+    m_checkpointedFrames = checkpointedFrames;
+
+    log(
+        DEBUG,
+        "checkpoint: WAL size=%" PRIu64 "KB, checkpointed %d/%d frames in %0.2fms",
+        (static_cast<uint64_t>(logFrames) * m_pageSize) / 1024,
+        checkpointedFrames,
+        logFrames,
+        duration.count());
+    return true;
 }
 
 void DataStore::deleteFlight(uint64_t flightId)
 {
-    log(DEBUG, "deleteFlight: Deleting flightId: %d", flightId);
-    string sql = "DELETE FROM flight_state WHERE flight_id=?";
+    string sql = "UPDATE flights SET deleted = 1 WHERE id=?";
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "deleteFlight: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return;
+    }
+    sqlite3_bind_int64(stmt, 1, flightId);
+    res = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (res != SQLITE_DONE)
+    {
+        log(ERROR, "deleteFlight: Failed to delete flight %" PRIu64 ": %d: %s", flightId, res, sqlite3_errmsg(m_db));
+        return;
+    }
+    log(DEBUG, "deleteFlight: Deleted flightId: %" PRIu64, flightId);
+}
+
+vector<uint64_t> DataStore::fetchDeletedFlights()
+{
+    vector<uint64_t> flightIds;
+    string sql = "SELECT id FROM flights WHERE deleted != 0 ORDER BY id ASC";
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "fetchDeletedFlights: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return flightIds;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        flightIds.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return flightIds;
+}
+
+static int deleteById(sqlite3* db, const char* sql, uint64_t id)
+{
     sqlite3_stmt* stmt;
-    sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
-    sqlite3_bind_int(stmt, 1, flightId);
-    sqlite3_step(stmt);
+    int res = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        return res;
+    }
+    sqlite3_bind_int64(stmt, 1, id);
+    res = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
+    return res;
+}
+
+int DataStore::purgeFlight(uint64_t flightId, int limit)
+{
+    // Straight off the (flight_id, timestamp) index, so each batch only touches the rows it removes.
+    // Newest first, so anything reading the flight can tell it's started going.
+    string sql =
+        "DELETE FROM flight_state WHERE id IN ("
+        "    SELECT id FROM flight_state WHERE flight_id=? ORDER BY timestamp DESC LIMIT ?"
+        ")";
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "purgeFlight: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, flightId);
+    sqlite3_bind_int(stmt, 2, limit);
 
-    sql = "DELETE FROM flights WHERE id=?";
-    sqlite3_prepare_v2(m_db, sql.c_str(), sql.length(), &stmt, nullptr);
-    sqlite3_bind_int(stmt, 1, flightId);
-    sqlite3_step(stmt);
+    res = startTransaction();
+    if (res != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        return -1;
+    }
+    res = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
-    log(DEBUG, "deleteFlight: Deleted flightId: %d", flightId);
+    int removed = sqlite3_changes(m_db);
+
+    // Nothing left, so the flight itself can go
+    if (res == SQLITE_DONE && removed == 0)
+    {
+        res = deleteById(m_db, "DELETE FROM flight_summary WHERE flight_id=?", flightId);
+    }
+    if (res == SQLITE_DONE && removed == 0)
+    {
+        res = deleteById(m_db, "DELETE FROM flights WHERE id=? AND deleted != 0", flightId);
+    }
+
+    if (res != SQLITE_DONE)
+    {
+        log(ERROR, "purgeFlight: Failed to purge flight %" PRIu64 ": %d: %s", flightId, res, sqlite3_errmsg(m_db));
+        rollbackTransaction();
+        return -1;
+    }
+    if (commitTransaction() != SQLITE_OK)
+    {
+        rollbackTransaction();
+        return -1;
+    }
+    return removed;
+}
+
+int DataStore::reclaimSpace(int pages)
+{
+    int mode = 0;
+    int freePages = 0;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(m_db, "PRAGMA auto_vacuum", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            mode = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (mode != 2)
+    {
+        // Not incremental, the free pages will be used again by new states instead
+        return 0;
+    }
+
+    string sql = "PRAGMA incremental_vacuum(" + to_string(pages) + ")";
+    char* err;
+    int res = sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &err);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "reclaimSpace: Failed to vacuum: %s", err);
+        sqlite3_free(err);
+        return -1;
+    }
+
+    if (sqlite3_prepare_v2(m_db, "PRAGMA freelist_count", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            freePages = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return freePages;
 }
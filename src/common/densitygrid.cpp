@@ -0,0 +1,292 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "blackbox/densitygrid.h"
+#include "blackbox/geo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+using namespace std;
+using namespace BlackBox;
+
+constexpr uint32_t FILE_MAGIC = 0x47444242; // BBDG
+constexpr uint32_t FILE_VERSION = 1;
+
+// Web Mercator runs from -HALF_WORLD to HALF_WORLD metres both ways
+constexpr double HALF_WORLD = M_PI * 6378137.0;
+
+static uint64_t key(uint32_t x, uint32_t y)
+{
+    return (static_cast<uint64_t>(y) << 32) | x;
+}
+
+DensityGrid::DensityGrid() : Logger("DensityGrid")
+{
+}
+
+void DensityGrid::apply(
+    array<uint64_t, LEVELS>& lastBins,
+    const double* latitudes,
+    const double* longitudes,
+    size_t count,
+    int delta)
+{
+    vector<double> x(count);
+    vector<double> y(count);
+    toWebMercator(latitudes, longitudes, count, x.data(), y.data());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        // 0 to 1 across the world, with y going south like the tiles do
+        const double u = clamp((x[i] + HALF_WORLD) / (2.0 * HALF_WORLD), 0.0, 1.0);
+        const double v = clamp((y[i] + HALF_WORLD) / (2.0 * HALF_WORLD), 0.0, 1.0);
+
+        for (int level = 0; level < LEVELS; level++)
+        {
+            const uint32_t bins = static_cast<uint32_t>(BINS) << level;
+            const uint32_t bx = min(static_cast<uint32_t>(u * bins), bins - 1);
+            const uint32_t by = min(static_cast<uint32_t>(v * bins), bins - 1);
+            const uint64_t bin = key(bx, by);
+            if (bin == lastBins[level])
+            {
+                continue;
+            }
+            lastBins[level] = bin;
+
+            uint32_t& value = m_levels[level][key(bx / BINS, by / BINS)][(by % BINS) * BINS + (bx % BINS)];
+            if (delta > 0)
+            {
+                value += delta;
+                m_maxCounts[level] = max(m_maxCounts[level], value);
+            }
+            else
+            {
+                // Don't wrap if it was added under different rules
+                value -= min(value, static_cast<uint32_t>(-delta));
+                m_maxDirty = true;
+            }
+        }
+    }
+}
+
+void DensityGrid::addFlight(uint64_t flightId, const double* latitudes, const double* longitudes, size_t count, uint64_t lastTimestamp)
+{
+    scoped_lock lock(m_mutex);
+    FlightProgress& progress = m_flights[flightId];
+    apply(progress.lastBins, latitudes, longitudes, count, 1);
+    progress.lastTimestamp = max(progress.lastTimestamp, lastTimestamp);
+}
+
+void DensityGrid::removeFlight(uint64_t flightId, const double* latitudes, const double* longitudes, size_t count)
+{
+    scoped_lock lock(m_mutex);
+    if (m_flights.erase(flightId) == 0)
+    {
+        return;
+    }
+
+    array<uint64_t, LEVELS> lastBins;
+    lastBins.fill(UINT64_MAX);
+    apply(lastBins, latitudes, longitudes, count, -1);
+}
+
+void DensityGrid::clear()
+{
+    scoped_lock lock(m_mutex);
+    for (auto& tiles : m_levels)
+    {
+        tiles.clear();
+    }
+    m_maxCounts.fill(0);
+    m_maxDirty = false;
+    m_flights.clear();
+}
+
+uint64_t DensityGrid::getLastTimestamp(uint64_t flightId) const
+{
+    scoped_lock lock(m_mutex);
+    auto it = m_flights.find(flightId);
+    return it != m_flights.end() ? it->second.lastTimestamp : 0;
+}
+
+map<uint64_t, uint64_t> DensityGrid::getFlights() const
+{
+    scoped_lock lock(m_mutex);
+    map<uint64_t, uint64_t> flights;
+    for (const auto& [flightId, progress] : m_flights)
+    {
+        flights.emplace(flightId, progress.lastTimestamp);
+    }
+    return flights;
+}
+
+bool DensityGrid::getTile(int level, int x, int y, Tile& tile) const
+{
+    if (level < 0 || level > MAX_LEVEL || x < 0 || y < 0)
+    {
+        return false;
+    }
+
+    scoped_lock lock(m_mutex);
+    const auto& tiles = m_levels[level];
+    auto it = tiles.find(key(x, y));
+    if (it == tiles.end())
+    {
+        return false;
+    }
+    tile = it->second;
+    return true;
+}
+
+void DensityGrid::updateMaxCounts() const
+{
+    for (int level = 0; level < LEVELS; level++)
+    {
+        uint32_t maxCount = 0;
+        for (const auto& [tileKey, tile] : m_levels[level])
+        {
+            maxCount = max(maxCount, *max_element(tile.begin(), tile.end()));
+        }
+        m_maxCounts[level] = maxCount;
+    }
+    m_maxDirty = false;
+}
+
+uint32_t DensityGrid::getMaxCount(int level) const
+{
+    scoped_lock lock(m_mutex);
+    if (m_maxDirty)
+    {
+        updateMaxCounts();
+    }
+    return m_maxCounts[clamp(level, 0, MAX_LEVEL)];
+}
+
+bool DensityGrid::save(const string& path)
+{
+    scoped_lock lock(m_mutex);
+
+    // Written alongside and moved in to place, so a crash can't leave half a file
+    string tmpPath = path + ".tmp";
+    FILE* fd = fopen(tmpPath.c_str(), "wb");
+    if (fd == nullptr)
+    {
+        log(ERROR, "save: Failed to open %s", tmpPath.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    auto write = [fd, &ok](const void* data, size_t size)
+    {
+        ok = ok && fwrite(data, size, 1, fd) == 1;
+    };
+
+    write(&FILE_MAGIC, sizeof(FILE_MAGIC));
+    write(&FILE_VERSION, sizeof(FILE_VERSION));
+
+    auto flightCount = static_cast<uint32_t>(m_flights.size());
+    write(&flightCount, sizeof(flightCount));
+    for (const auto& [flightId, progress] : m_flights)
+    {
+        write(&flightId, sizeof(flightId));
+        write(&progress.lastTimestamp, sizeof(progress.lastTimestamp));
+        write(progress.lastBins.data(), sizeof(progress.lastBins));
+    }
+
+    for (const auto& tiles : m_levels)
+    {
+        auto tileCount = static_cast<uint32_t>(tiles.size());
+        write(&tileCount, sizeof(tileCount));
+        for (const auto& [tileKey, tile] : tiles)
+        {
+            write(&tileKey, sizeof(tileKey));
+            write(tile.data(), sizeof(tile));
+        }
+    }
+
+    ok = fclose(fd) == 0 && ok;
+    if (!ok)
+    {
+        log(ERROR, "save: Failed to write %s", tmpPath.c_str());
+        return false;
+    }
+
+    error_code ec;
+    filesystem::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        log(ERROR, "save: Failed to rename %s: %s", tmpPath.c_str(), ec.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool DensityGrid::load(const string& path)
+{
+    FILE* fd = fopen(path.c_str(), "rb");
+    if (fd == nullptr)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    auto read = [fd, &ok](void* data, size_t size)
+    {
+        ok = ok && fread(data, size, 1, fd) == 1;
+    };
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    read(&magic, sizeof(magic));
+    read(&version, sizeof(version));
+    if (!ok || magic != FILE_MAGIC || version != FILE_VERSION)
+    {
+        log(WARN, "load: %s isn't a density grid we understand", path.c_str());
+        fclose(fd);
+        return false;
+    }
+
+    map<uint64_t, FlightProgress> flights;
+    uint32_t flightCount = 0;
+    read(&flightCount, sizeof(flightCount));
+    for (uint32_t i = 0; ok && i < flightCount; i++)
+    {
+        uint64_t flightId = 0;
+        FlightProgress progress;
+        read(&flightId, sizeof(flightId));
+        read(&progress.lastTimestamp, sizeof(progress.lastTimestamp));
+        read(progress.lastBins.data(), sizeof(progress.lastBins));
+        flights.emplace(flightId, progress);
+    }
+
+    array<map<uint64_t, Tile>, LEVELS> levels;
+    for (int level = 0; ok && level < LEVELS; level++)
+    {
+        uint32_t tileCount = 0;
+        read(&tileCount, sizeof(tileCount));
+        for (uint32_t i = 0; ok && i < tileCount; i++)
+        {
+            uint64_t tileKey = 0;
+            read(&tileKey, sizeof(tileKey));
+            read(levels[level][tileKey].data(), sizeof(Tile));
+        }
+    }
+    fclose(fd);
+
+    if (!ok)
+    {
+        log(WARN, "load: %s is truncated", path.c_str());
+        return false;
+    }
+
+    scoped_lock lock(m_mutex);
+    m_levels = std::move(levels);
+    m_flights = std::move(flights);
+    updateMaxCounts();
+    log(INFO, "load: Loaded %zu flights from %s", m_flights.size(), path.c_str());
+    return true;
+}
@@ -0,0 +1,363 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "blackbox/geo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BLACKBOX_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace UFC;
+
+constexpr double EARTH_RADIUS_KM = 6371.0;
+constexpr double DEGREES_TO_RADIANS = M_PI / 180.0;
+
+float degreesToRadians(float degrees)
+{
+    return degrees * M_PI / 180.0f;
+}
+
+double distance(Coordinate c1, Coordinate c2)
+{
+    const double latitudes[] = {c1.latitude, c2.latitude};
+    const double longitudes[] = {c1.longitude, c2.longitude};
+    return trackDistanceScalar(latitudes, longitudes, 2);
+}
+
+// Where the projection stops being square
+constexpr double MAX_LATITUDE = 85.0511287798;
+constexpr double ORIGIN_SHIFT = M_PI * 6378137.0;
+
+void toWebMercator(double latitude, double longitude, double& x, double& y)
+{
+    latitude = clamp(latitude, -MAX_LATITUDE, MAX_LATITUDE);
+    x = longitude * ORIGIN_SHIFT / 180.0;
+    y = -log(tan((90.0 + latitude) * M_PI / 360.0)) / DEGREES_TO_RADIANS * ORIGIN_SHIFT / 180.0;
+}
+
+void toWebMercatorScalar(const double* latitudes, const double* longitudes, size_t count, double* x, double* y)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        toWebMercator(latitudes[i], longitudes[i], x[i], y[i]);
+    }
+}
+
+Coordinate destination(Coordinate start, double bearing, double distance)
+{
+    const double lat1 = start.latitude * DEGREES_TO_RADIANS;
+    const double lon1 = start.longitude * DEGREES_TO_RADIANS;
+    const double theta = bearing * DEGREES_TO_RADIANS;
+    const double delta = distance / EARTH_RADIUS_KM;
+
+    const double lat2 = asin(sin(lat1) * cos(delta) + cos(lat1) * sin(delta) * cos(theta));
+    const double lon2 = lon1 + atan2(sin(theta) * sin(delta) * cos(lat1), cos(delta) - sin(lat1) * sin(lat2));
+
+    Coordinate end = start;
+    end.latitude = lat2 / DEGREES_TO_RADIANS;
+    end.longitude = remainder(lon2 / DEGREES_TO_RADIANS, 360.0);
+    return end;
+}
+
+// Fills in the running total, the segments have to be added up in order anyway
+static double accumulate(const double* segments, size_t count, double* cumulative)
+{
+    double total = 0.0;
+    if (cumulative != nullptr)
+    {
+        cumulative[0] = 0.0;
+    }
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        total += segments[i];
+        if (cumulative != nullptr)
+        {
+            cumulative[i + 1] = total;
+        }
+    }
+    return total;
+}
+
+double trackDistanceScalar(const double* latitudes, const double* longitudes, size_t count, double* segments, double* cumulative)
+{
+    if (count < 2)
+    {
+        if (cumulative != nullptr && count == 1)
+        {
+            cumulative[0] = 0.0;
+        }
+        return 0.0;
+    }
+
+    double total = 0.0;
+    if (cumulative != nullptr)
+    {
+        cumulative[0] = 0.0;
+    }
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        const double lat1 = latitudes[i] * DEGREES_TO_RADIANS;
+        const double lat2 = latitudes[i + 1] * DEGREES_TO_RADIANS;
+        const double sinLat = sin((lat2 - lat1) * 0.5);
+        const double sinLon = sin((longitudes[i + 1] - longitudes[i]) * DEGREES_TO_RADIANS * 0.5);
+
+        const double a = clamp(sinLat * sinLat + cos(lat1) * cos(lat2) * sinLon * sinLon, 0.0, 1.0);
+        const double d = 2.0 * EARTH_RADIUS_KM * asin(sqrt(a));
+
+        total += d;
+        if (segments != nullptr)
+        {
+            segments[i] = d;
+        }
+        if (cumulative != nullptr)
+        {
+            cumulative[i + 1] = total;
+        }
+    }
+    return total;
+}
+
+#ifdef BLACKBOX_HAVE_AVX2
+
+// Good to ~1e-14 for |x| <= pi/2
+__attribute__((target("avx2,fma")))
+static inline __m256d sin256(__m256d x)
+{
+    const __m256d x2 = _mm256_mul_pd(x, x);
+    __m256d p = _mm256_set1_pd(1.0 / 355687428096000.0);             // 1/17!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(-1.0 / 1307674368000.0)); // 1/15!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(1.0 / 6227020800.0));     // 1/13!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(-1.0 / 39916800.0));      // 1/11!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(1.0 / 362880.0));         // 1/9!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(-1.0 / 5040.0));          // 1/7!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(1.0 / 120.0));            // 1/5!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(-1.0 / 6.0));             // 1/3!
+    return _mm256_fmadd_pd(_mm256_mul_pd(p, x2), x, x);
+}
+
+// Good to ~1e-14 for |x| <= pi/2
+__attribute__((target("avx2,fma")))
+static inline __m256d cos256(__m256d x)
+{
+    const __m256d x2 = _mm256_mul_pd(x, x);
+    __m256d p = _mm256_set1_pd(1.0 / 6402373705728000.0);               // 1/18!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(-1.0 / 20922789888000.0)); // 1/16!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(1.0 / 87178291200.0));     // 1/14!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(-1.0 / 479001600.0));      // 1/12!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(1.0 / 3628800.0));         // 1/10!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(-1.0 / 40320.0));          // 1/8!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(1.0 / 720.0));             // 1/6!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(-1.0 / 24.0));             // 1/4!
+    p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(0.5));
+    return _mm256_fnmadd_pd(p, x2, _mm256_set1_pd(1.0));
+}
+
+// Cephes' rational approximation, good to 1 ulp for 0 <= x <= 0.625
+__attribute__((target("avx2,fma")))
+static inline __m256d asinSmall256(__m256d x)
+{
+    const __m256d z = _mm256_mul_pd(x, x);
+    __m256d p = _mm256_set1_pd(4.253011369004428248960E-3);
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-6.019598008014123785661E-1));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(5.444622390564711410273E0));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.626247967210700244449E1));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(1.956261983317594739197E1));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-8.198089802484824371615E0));
+
+    __m256d q = _mm256_add_pd(z, _mm256_set1_pd(-1.474091372988853791896E1));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(7.049610280856842141659E1));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(-1.471791292232726029859E2));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(1.395105614657485689735E2));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(-4.918853881490881290097E1));
+
+    return _mm256_fmadd_pd(_mm256_mul_pd(x, z), _mm256_div_pd(p, q), x);
+}
+
+// For 0 <= x <= 1
+__attribute__((target("avx2,fma")))
+static inline __m256d asin256(__m256d x)
+{
+    // asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2)) keeps the approximation in range
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d big = _mm256_cmp_pd(x, half, _CMP_GT_OQ);
+    const __m256d reduced = _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), x), half));
+    const __m256d r = asinSmall256(_mm256_blendv_pd(x, reduced, big));
+    const __m256d bigResult = _mm256_fnmadd_pd(_mm256_set1_pd(2.0), r, _mm256_set1_pd(M_PI_2));
+    return _mm256_blendv_pd(r, bigResult, big);
+}
+
+__attribute__((target("avx2,fma")))
+static double trackDistanceAVX2(const double* latitudes, const double* longitudes, size_t count, double* segments, double* cumulative)
+{
+    if (count < 2)
+    {
+        return trackDistanceScalar(latitudes, longitudes, count, segments, cumulative);
+    }
+
+    // Segments are needed to fill in the running total
+    vector<double> buffer;
+    if (segments == nullptr && cumulative != nullptr)
+    {
+        buffer.resize(count - 1);
+        segments = buffer.data();
+    }
+
+    const __m256d toRadians = _mm256_set1_pd(DEGREES_TO_RADIANS);
+    const __m256d twoPi = _mm256_set1_pd(2.0 * M_PI);
+    const __m256d invTwoPi = _mm256_set1_pd(1.0 / (2.0 * M_PI));
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d diameter = _mm256_set1_pd(2.0 * EARTH_RADIUS_KM);
+    __m256d total = zero;
+
+    const size_t segmentCount = count - 1;
+    size_t i = 0;
+    for (; i + 4 <= segmentCount; i += 4)
+    {
+        const __m256d lat1 = _mm256_mul_pd(_mm256_loadu_pd(latitudes + i), toRadians);
+        const __m256d lat2 = _mm256_mul_pd(_mm256_loadu_pd(latitudes + i + 1), toRadians);
+        __m256d dLon = _mm256_mul_pd(
+            _mm256_sub_pd(_mm256_loadu_pd(longitudes + i + 1), _mm256_loadu_pd(longitudes + i)),
+            toRadians);
+
+        // Crossing the anti-meridian, keep the half angle within +/- pi/2
+        const __m256d turns = _mm256_round_pd(_mm256_mul_pd(dLon, invTwoPi), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        dLon = _mm256_fnmadd_pd(turns, twoPi, dLon);
+
+        const __m256d sinLat = sin256(_mm256_mul_pd(_mm256_sub_pd(lat2, lat1), _mm256_set1_pd(0.5)));
+        const __m256d sinLon = sin256(_mm256_mul_pd(dLon, _mm256_set1_pd(0.5)));
+        const __m256d cosLat = _mm256_mul_pd(cos256(lat1), cos256(lat2));
+
+        __m256d a = _mm256_fmadd_pd(_mm256_mul_pd(cosLat, sinLon), sinLon, _mm256_mul_pd(sinLat, sinLat));
+        a = _mm256_min_pd(_mm256_max_pd(a, zero), one);
+
+        const __m256d d = _mm256_mul_pd(diameter, asin256(_mm256_sqrt_pd(a)));
+        if (segments != nullptr)
+        {
+            _mm256_storeu_pd(segments + i, d);
+        }
+        total = _mm256_add_pd(total, d);
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, total);
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    // Whatever didn't fill a vector
+    if (i < segmentCount)
+    {
+        sum += trackDistanceScalar(latitudes + i, longitudes + i, count - i, segments != nullptr ? segments + i : nullptr, nullptr);
+    }
+
+    if (cumulative != nullptr)
+    {
+        // Summed in order so the last entry is exactly the total we return
+        return accumulate(segments, count, cumulative);
+    }
+    return sum;
+}
+
+// Natural log for normal, positive x. Good to ~1e-16.
+__attribute__((target("avx2,fma")))
+static inline __m256d log256(__m256d x)
+{
+    // Split in to 2^e * m with 1 <= m < 2
+    const __m256i bits = _mm256_castpd_si256(x);
+    const __m256i mantissaMask = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(
+        _mm256_and_si256(bits, mantissaMask),
+        _mm256_set1_epi64x(0x3FF0000000000000LL)));
+
+    // There's no AVX2 int64 to double, but a biased exponent fits in the bottom of 2^52's mantissa
+    const __m256i biased = _mm256_srli_epi64(bits, 52);
+    const __m256d twoTo52 = _mm256_set1_pd(4503599627370496.0);
+    __m256d e = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(biased, _mm256_castpd_si256(twoTo52))),
+        _mm256_set1_pd(4503599627370496.0 + 1023.0));
+
+    // Keep m within sqrt(1/2) and sqrt(2) so the series converges quickly
+    const __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(M_SQRT2), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    e = _mm256_add_pd(e, _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+
+    // log(m) = 2 atanh(t), |t| <= 0.172
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d t = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    const __m256d t2 = _mm256_mul_pd(t, t);
+    __m256d p = _mm256_set1_pd(1.0 / 23.0);
+    for (int n = 21; n >= 3; n -= 2)
+    {
+        p = _mm256_fmadd_pd(p, t2, _mm256_set1_pd(1.0 / n));
+    }
+    p = _mm256_fmadd_pd(p, t2, one);
+    const __m256d logM = _mm256_mul_pd(_mm256_add_pd(t, t), p);
+    return _mm256_fmadd_pd(e, _mm256_set1_pd(M_LN2), logM);
+}
+
+__attribute__((target("avx2,fma")))
+static void toWebMercatorAVX2(const double* latitudes, const double* longitudes, size_t count, double* x, double* y)
+{
+    const __m256d toRadians = _mm256_set1_pd(DEGREES_TO_RADIANS);
+    const __m256d maxLatitude = _mm256_set1_pd(MAX_LATITUDE);
+    const __m256d minLatitude = _mm256_set1_pd(-MAX_LATITUDE);
+    const __m256d xScale = _mm256_set1_pd(ORIGIN_SHIFT / 180.0);
+    const __m256d yScale = _mm256_set1_pd(-ORIGIN_SHIFT / M_PI);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(longitudes + i), xScale));
+
+        // tan(pi/4 + lat/2) = (1 + sin(lat)) / cos(lat), which doesn't lose anything near the poles
+        __m256d latitude = _mm256_loadu_pd(latitudes + i);
+        latitude = _mm256_min_pd(_mm256_max_pd(latitude, minLatitude), maxLatitude);
+        latitude = _mm256_mul_pd(latitude, toRadians);
+        const __m256d ratio = _mm256_div_pd(_mm256_add_pd(_mm256_set1_pd(1.0), sin256(latitude)), cos256(latitude));
+        _mm256_storeu_pd(y + i, _mm256_mul_pd(log256(ratio), yScale));
+    }
+
+    // Whatever didn't fill a vector
+    toWebMercatorScalar(latitudes + i, longitudes + i, count - i, x + i, y + i);
+}
+
+#endif
+
+bool hasAVX2()
+{
+#ifdef BLACKBOX_HAVE_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+double trackDistance(const double* latitudes, const double* longitudes, size_t count, double* segments, double* cumulative)
+{
+#ifdef BLACKBOX_HAVE_AVX2
+    if (hasAVX2())
+    {
+        return trackDistanceAVX2(latitudes, longitudes, count, segments, cumulative);
+    }
+#endif
+    return trackDistanceScalar(latitudes, longitudes, count, segments, cumulative);
+}
+
+void toWebMercator(const double* latitudes, const double* longitudes, size_t count, double* x, double* y)
+{
+#ifdef BLACKBOX_HAVE_AVX2
+    if (hasAVX2())
+    {
+        toWebMercatorAVX2(latitudes, longitudes, count, x, y);
+        return;
+    }
+#endif
+    toWebMercatorScalar(latitudes, longitudes, count, x, y);
+}
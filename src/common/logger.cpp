@@ -20,6 +20,7 @@
 
 
 #include <cstdarg>
+#include <ctime>
 #include "blackbox/logger.h"
 
 using namespace std;
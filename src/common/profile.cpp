@@ -0,0 +1,81 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "blackbox/profile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+const char* getProfileSeriesName(ProfileSeries series)
+{
+    switch (series)
+    {
+        case ProfileSeries::ALTITUDE: return "Altitude";
+        case ProfileSeries::AGL: return "Height AGL";
+        case ProfileSeries::FPM: return "Vertical Speed";
+        case ProfileSeries::INDICATED_AIR_SPEED: return "Indicated Air Speed";
+        case ProfileSeries::GROUND_SPEED: return "Ground Speed";
+    }
+    return "";
+}
+
+void Profile::decimate(
+    ProfileSeries series,
+    uint64_t start,
+    uint64_t end,
+    int buckets,
+    float* minimums,
+    float* maximums) const
+{
+    // There's nothing to fill in, and minimums + buckets would point before the array
+    if (buckets <= 0)
+    {
+        return;
+    }
+
+    fill(minimums, minimums + buckets, numeric_limits<float>::quiet_NaN());
+    fill(maximums, maximums + buckets, numeric_limits<float>::quiet_NaN());
+    if (end <= start)
+    {
+        return;
+    }
+
+    // Only the samples in view
+    auto first = static_cast<size_t>(lower_bound(timestamps.begin(), timestamps.end(), start) - timestamps.begin());
+    auto last = static_cast<size_t>(upper_bound(timestamps.begin(), timestamps.end(), end) - timestamps.begin());
+
+    const float* v = get(series).data();
+    const uint64_t* t = timestamps.data();
+    const double bucketsPerMs = static_cast<double>(buckets) / static_cast<double>(end - start);
+
+    int bucket = -1;
+    float lo = 0.0f;
+    float hi = 0.0f;
+    for (size_t i = first; i < last; i++)
+    {
+        int b = min(static_cast<int>(static_cast<double>(t[i] - start) * bucketsPerMs), buckets - 1);
+        if (b != bucket)
+        {
+            if (bucket >= 0)
+            {
+                minimums[bucket] = lo;
+                maximums[bucket] = hi;
+            }
+            bucket = b;
+            lo = v[i];
+            hi = v[i];
+            continue;
+        }
+        lo = min(lo, v[i]);
+        hi = max(hi, v[i]);
+    }
+    if (bucket >= 0)
+    {
+        minimums[bucket] = lo;
+        maximums[bucket] = hi;
+    }
+}
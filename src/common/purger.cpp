@@ -0,0 +1,132 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "blackbox/purger.h"
+
+#include <chrono>
+#include <cinttypes>
+
+using namespace std;
+using namespace BlackBox;
+
+// A few milliseconds of work per transaction, well inside the writer's busy timeout
+constexpr int PURGE_BATCH_SIZE = 2000;
+constexpr int VACUUM_PAGES = 256;
+
+// Leave the writer a gap between batches
+constexpr chrono::milliseconds BATCH_DELAY(20);
+
+// Automatic checkpoints are off, so don't let the WAL grow while a big flight goes
+constexpr uint64_t CHECKPOINT_WAL_SIZE = 16 * 1024 * 1024;
+
+Purger::Purger(string dbPath) : Logger("Purger"), m_dbPath(std::move(dbPath))
+{
+    m_thread = thread([this]() { run(); });
+}
+
+Purger::~Purger()
+{
+    {
+        lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_signal.notify_one();
+    m_thread.join();
+}
+
+void Purger::wake()
+{
+    {
+        lock_guard lock(m_mutex);
+        m_pending = true;
+    }
+    m_signal.notify_one();
+}
+
+bool Purger::isStopping()
+{
+    lock_guard lock(m_mutex);
+    return m_stopping;
+}
+
+void Purger::run()
+{
+    DataStore dataStore;
+    bool open = false;
+
+    while (true)
+    {
+        {
+            unique_lock lock(m_mutex);
+            m_signal.wait(lock, [this]() { return m_stopping || m_pending; });
+            if (m_stopping)
+            {
+                break;
+            }
+            m_pending = false;
+        }
+
+        if (!open)
+        {
+            open = dataStore.init(m_dbPath);
+            if (!open)
+            {
+                log(ERROR, "run: Failed to open database");
+                continue;
+            }
+        }
+        purge(dataStore);
+    }
+}
+
+bool Purger::purge(DataStore& dataStore)
+{
+    auto flightIds = dataStore.fetchDeletedFlights();
+    if (flightIds.empty())
+    {
+        return true;
+    }
+
+    auto startTime = chrono::steady_clock::now();
+    size_t states = 0;
+    for (uint64_t flightId : flightIds)
+    {
+        log(INFO, "purge: Purging flight %" PRIu64, flightId);
+        while (true)
+        {
+            if (isStopping())
+            {
+                // It'll carry on from here next time
+                return false;
+            }
+
+            int removed = dataStore.purgeFlight(flightId, PURGE_BATCH_SIZE);
+            if (removed < 0)
+            {
+                return false;
+            }
+            if (dataStore.getPendingWALSize() > CHECKPOINT_WAL_SIZE)
+            {
+                dataStore.checkpoint();
+            }
+            if (removed == 0)
+            {
+                break;
+            }
+            states += removed;
+            this_thread::sleep_for(BATCH_DELAY);
+        }
+    }
+
+    int freePages;
+    while ((freePages = dataStore.reclaimSpace(VACUUM_PAGES)) > 0 && !isStopping())
+    {
+        this_thread::sleep_for(BATCH_DELAY);
+    }
+    dataStore.checkpoint();
+
+    auto duration = chrono::duration<float>(chrono::steady_clock::now() - startTime);
+    log(INFO, "purge: Purged %zu flights (%zu states) in %0.1f seconds", flightIds.size(), states, duration.count());
+    return freePages >= 0;
+}
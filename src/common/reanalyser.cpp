@@ -0,0 +1,264 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "blackbox/reanalyser.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <thread>
+
+using namespace std;
+using namespace BlackBox;
+
+// Changed states per transaction
+constexpr size_t WRITE_BATCH_SIZE = 50000;
+
+// Workers wait for the writer once this many changes are queued
+constexpr size_t MAX_PENDING = WRITE_BATCH_SIZE * 4;
+
+constexpr int MAX_WRITE_ATTEMPTS = 20;
+constexpr chrono::milliseconds WRITE_RETRY_DELAY(100);
+
+// The newest flight may still be being recorded if it's been written to this recently
+constexpr uint64_t LIVE_FLIGHT_TIME_MS = 5 * 60 * 1000;
+
+Reanalyser::Reanalyser(string dbPath, const PhaseThresholds& thresholds, unsigned int threads) :
+    Logger("Reanalyser"),
+    m_dbPath(std::move(dbPath)),
+    m_thresholds(thresholds),
+    m_threads(threads)
+{
+    if (m_threads == 0)
+    {
+        m_threads = max(1u, thread::hardware_concurrency());
+    }
+}
+
+ReanalyseResult Reanalyser::run(const function<void(size_t done, size_t total)>& progress)
+{
+    ReanalyseResult result;
+    auto startTime = chrono::steady_clock::now();
+
+    DataStore dataStore;
+    if (!dataStore.init(m_dbPath))
+    {
+        result.success = false;
+        return result;
+    }
+
+    auto flights = dataStore.fetchFlights();
+    if (!flights.empty())
+    {
+        // The plugin keeps its own copy of the live flight's summary and would write over ours
+        auto now = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        const Flight& last = flights.back();
+        if (last.summary.endTime + LIVE_FLIGHT_TIME_MS > static_cast<uint64_t>(now))
+        {
+            log(INFO, "run: Skipping flight %" PRIu64 ", it may still be recording", last.id);
+            flights.pop_back();
+        }
+    }
+
+    m_flightIds.clear();
+    for (const Flight& flight : flights)
+    {
+        m_flightIds.push_back(flight.id);
+    }
+    m_nextFlight = 0;
+    m_flightsDone = 0;
+    m_states = 0;
+    m_pending.clear();
+    m_pendingSummaries.clear();
+    m_cancelled = false;
+
+    unsigned int threads = min(m_threads, static_cast<unsigned int>(max<size_t>(1, m_flightIds.size())));
+    log(INFO, "run: Re-analysing %zu flights with %u threads", m_flightIds.size(), threads);
+
+    m_runningWorkers = threads;
+    vector<thread> workers;
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        workers.emplace_back(&Reanalyser::worker, this);
+    }
+
+    vector<pair<uint64_t, State>> changes;
+    vector<pair<uint64_t, FlightSummary>> summaries;
+    while (true)
+    {
+        bool finished;
+        {
+            unique_lock lock(m_mutex);
+            m_pendingSignal.wait_for(lock, chrono::milliseconds(100), [this]()
+            {
+                return m_pending.size() >= WRITE_BATCH_SIZE || m_runningWorkers == 0;
+            });
+            finished = m_runningWorkers == 0;
+            if (m_pending.size() >= WRITE_BATCH_SIZE || finished)
+            {
+                changes.swap(m_pending);
+                summaries.swap(m_pendingSummaries);
+            }
+        }
+        m_spaceSignal.notify_all();
+
+        if (!changes.empty())
+        {
+            if (!writePending(dataStore, changes, summaries))
+            {
+                result.success = false;
+                {
+                    scoped_lock lock(m_mutex);
+                    m_cancelled = true;
+                }
+                m_spaceSignal.notify_all();
+                break;
+            }
+            result.changed += changes.size();
+            changes.clear();
+            summaries.clear();
+        }
+
+        if (progress != nullptr)
+        {
+            progress(m_flightsDone, m_flightIds.size());
+        }
+
+        if (finished)
+        {
+            break;
+        }
+    }
+
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    result.flights = m_flightsDone;
+    if (result.flights < m_flightIds.size())
+    {
+        // A worker couldn't open the database
+        result.success = false;
+    }
+    result.states = m_states;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    log(
+        INFO,
+        "run: Re-analysed %zu flights (%zu states, %zu changed) in %0.2f seconds, %0.1f flights/second",
+        result.flights,
+        result.states,
+        result.changed,
+        result.seconds,
+        result.getFlightsPerSecond());
+    return result;
+}
+
+void Reanalyser::worker()
+{
+    DataStore dataStore;
+    bool ok = dataStore.init(m_dbPath);
+
+    vector<uint64_t> stateIds;
+    vector<pair<FlightPhase, EventType>> original;
+    vector<pair<uint64_t, State>> changes;
+    while (ok)
+    {
+        size_t index = m_nextFlight++;
+        if (index >= m_flightIds.size())
+        {
+            break;
+        }
+
+        stateIds.clear();
+        vector<State> states = dataStore.fetchUpdates(m_flightIds[index], 0, &stateIds);
+
+        original.clear();
+        for (const State& state : states)
+        {
+            original.emplace_back(state.flightPhase, state.eventType);
+        }
+
+        FlightSummary summary;
+        bool changed = reclassify(states, m_thresholds) > 0;
+        if (changed)
+        {
+            summary.add(states);
+            for (size_t i = 0; i < states.size(); i++)
+            {
+                if (original[i].first != states[i].flightPhase || original[i].second != states[i].eventType)
+                {
+                    changes.emplace_back(stateIds[i], states[i]);
+                }
+            }
+        }
+        m_states += states.size();
+
+        {
+            unique_lock lock(m_mutex);
+            m_spaceSignal.wait(lock, [this]() { return m_pending.size() < MAX_PENDING || m_cancelled; });
+            if (m_cancelled)
+            {
+                break;
+            }
+            m_pending.insert(m_pending.end(), changes.begin(), changes.end());
+            if (changed)
+            {
+                m_pendingSummaries.emplace_back(m_flightIds[index], summary);
+            }
+            if (m_pending.size() >= WRITE_BATCH_SIZE)
+            {
+                m_pendingSignal.notify_one();
+            }
+        }
+        changes.clear();
+        m_flightsDone++;
+    }
+
+    {
+        scoped_lock lock(m_mutex);
+        m_runningWorkers--;
+    }
+    m_pendingSignal.notify_one();
+}
+
+bool Reanalyser::writePending(
+    DataStore& dataStore,
+    const vector<pair<uint64_t, State>>& changes,
+    const vector<pair<uint64_t, FlightSummary>>& summaries)
+{
+    for (int attempt = 1; attempt <= MAX_WRITE_ATTEMPTS; attempt++)
+    {
+        // The plugin may be recording at the same time, so just try again if it has the lock
+        int res = dataStore.startTransaction();
+        for (auto it = changes.begin(); res == SQLITE_OK && it != changes.end(); ++it)
+        {
+            res = dataStore.updatePhase(it->first, it->second);
+        }
+        for (auto it = summaries.begin(); res == SQLITE_OK && it != summaries.end(); ++it)
+        {
+            res = dataStore.writeSummary(it->first, it->second);
+        }
+        if (res == SQLITE_OK)
+        {
+            res = dataStore.commitTransaction();
+        }
+        if (res == SQLITE_OK)
+        {
+            // Automatic checkpoints are off, so don't let the WAL grow for the whole run
+            dataStore.checkpoint();
+            return true;
+        }
+
+        dataStore.rollbackTransaction();
+        if (res != SQLITE_BUSY && res != SQLITE_LOCKED)
+        {
+            break;
+        }
+        log(WARN, "writePending: Database is busy, retrying (%d/%d)", attempt, MAX_WRITE_ATTEMPTS);
+        this_thread::sleep_for(WRITE_RETRY_DELAY);
+    }
+
+    log(ERROR, "writePending: Failed to write %zu changes", changes.size());
+    return false;
+}
@@ -0,0 +1,107 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "blackbox/summary.h"
+#include "blackbox/geo.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+void FlightSummary::add(const State& state)
+{
+    UFC::Coordinate from = lastPosition;
+    if (extend(state))
+    {
+        distance += ::distance(from, state.position);
+    }
+}
+
+void FlightSummary::add(span<const State> states)
+{
+    // Pick out the track the same way extend() will, starting from where we left off
+    vector<double> latitudes;
+    vector<double> longitudes;
+    latitudes.reserve(states.size() + 1);
+    longitudes.reserve(states.size() + 1);
+    if (samples > 0)
+    {
+        latitudes.push_back(lastPosition.latitude);
+        longitudes.push_back(lastPosition.longitude);
+    }
+    uint64_t trackEnd = endTime;
+    bool started = samples > 0;
+    for (const State& state : states)
+    {
+        if (!started || state.timestamp >= trackEnd)
+        {
+            latitudes.push_back(state.position.latitude);
+            longitudes.push_back(state.position.longitude);
+            trackEnd = state.timestamp;
+            started = true;
+        }
+    }
+
+    vector<double> segments(max<size_t>(latitudes.size(), 1) - 1);
+    trackDistance(latitudes.data(), longitudes.data(), latitudes.size(), segments.data());
+
+    size_t segment = 0;
+    for (const State& state : states)
+    {
+        if (extend(state))
+        {
+            distance += segments[segment++];
+        }
+    }
+}
+
+bool FlightSummary::extend(const State& state)
+{
+    const double latitude = state.position.latitude;
+    const double longitude = state.position.longitude;
+    const bool airborne = !state.anyOnGround;
+
+    if (state.eventType == EventType::LANDING)
+    {
+        landed = true;
+        touchdownFPM = state.fpm;
+    }
+
+    samples++;
+    if (samples == 1)
+    {
+        startTime = state.timestamp;
+        endTime = state.timestamp;
+        maxAltitude = static_cast<float>(state.position.altitude);
+        minLatitude = maxLatitude = latitude;
+        minLongitude = maxLongitude = longitude;
+        lastPosition = state.position;
+        lastAirborne = airborne;
+        return false;
+    }
+
+    maxAltitude = max(maxAltitude, static_cast<float>(state.position.altitude));
+    minLatitude = min(minLatitude, latitude);
+    maxLatitude = max(maxLatitude, latitude);
+    minLongitude = min(minLongitude, longitude);
+    maxLongitude = max(maxLongitude, longitude);
+
+    if (state.timestamp < endTime)
+    {
+        // Take offs and landings are written ahead of the states around them. Joining the
+        // path back up would only add a zig-zag, so just leave it out of the distance.
+        startTime = min(startTime, state.timestamp);
+        return false;
+    }
+
+    if (lastAirborne)
+    {
+        airborneTime += state.timestamp - endTime;
+    }
+    endTime = state.timestamp;
+    lastPosition = state.position;
+    lastAirborne = airborne;
+    return true;
+}
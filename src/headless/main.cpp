@@ -0,0 +1,488 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+// Loads bbplugin in to a fake X-Plane and flies it as fast as possible
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+#include <dlfcn.h>
+
+#include <XPLMPlugin.h>
+
+#include "blackbox/datastore.h"
+#include "blackbox/geo.h"
+#include "blackbox/track.h"
+#include "script.h"
+#include "simulator.h"
+
+using namespace std;
+
+typedef int (*XPluginStart_f)(char* outName, char* outSig, char* outDesc);
+typedef void (*XPluginStop_f)();
+typedef int (*XPluginEnable_f)();
+typedef void (*XPluginDisable_f)();
+typedef void (*XPluginReceiveMessage_f)(XPLMPluginID inFrom, int inMsg, void* inParam);
+
+void usage(const char* argv0)
+{
+    printf("Usage: %s [options] <path to bbplugin>\n", argv0);
+    printf("  --output <dir>        Where to put Output/blackbox (default: ./headless)\n");
+    printf("  --fps <n>             Simulated frame rate (default: 60)\n");
+    printf("  --cruise <seconds>    Length of the cruise for the built in flight (default: 3600)\n");
+    printf("  --replay <file.csv>   Replay recorded datarefs instead of the built in flight\n");
+    printf("  --airport <id,lat,lon> Add an airport to the nav database\n");
+    printf("  --verbose             Show the plugin's log\n");
+    printf("  --benchmark-distance <points>  Compare the track distance kernels and exit\n");
+    printf("  --benchmark-route <hours>      Time adding to a live route's track and projection and exit\n");
+    printf("  --benchmark-projection <points> Compare the Web Mercator kernels (a million is a long route) and exit\n");
+}
+
+float percentile(vector<float>& values, float p)
+{
+    if (values.empty())
+    {
+        return 0.0f;
+    }
+    size_t n = static_cast<size_t>(p * static_cast<float>(values.size() - 1));
+    nth_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(n), values.end());
+    return values[n];
+}
+
+// Times the scalar and dispatched track distance kernels over a random walk and checks they agree
+int benchmarkDistance(size_t count)
+{
+    if (count < 2)
+    {
+        printf("Need at least 2 points\n");
+        return 1;
+    }
+
+    // Roughly a second apart at airliner speeds, with the odd jump across the anti-meridian
+    mt19937_64 random(1);
+    uniform_real_distribution<double> step(-0.005, 0.005);
+    vector<double> latitudes(count);
+    vector<double> longitudes(count);
+    double latitude = 51.47;
+    double longitude = 179.9;
+    for (size_t i = 0; i < count; i++)
+    {
+        latitude = clamp(latitude + step(random), -89.0, 89.0);
+        longitude += step(random) + 0.002;
+        if (longitude > 180.0)
+        {
+            longitude -= 360.0;
+        }
+        latitudes[i] = latitude;
+        longitudes[i] = longitude;
+    }
+
+    vector<double> expected(count - 1);
+    vector<double> actual(count - 1);
+    vector<double> cumulative(count);
+
+    const int runs = 10;
+    double scalarTotal = 0.0;
+    double total = 0.0;
+    auto startTime = chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++)
+    {
+        scalarTotal = trackDistanceScalar(latitudes.data(), longitudes.data(), count, expected.data());
+    }
+    double scalarTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count() / runs;
+
+    startTime = chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++)
+    {
+        total = trackDistance(latitudes.data(), longitudes.data(), count, actual.data(), cumulative.data());
+    }
+    double time = chrono::duration<double>(chrono::steady_clock::now() - startTime).count() / runs;
+
+    double maxError = 0.0;
+    for (size_t i = 0; i < count - 1; i++)
+    {
+        maxError = max(maxError, abs(actual[i] - expected[i]));
+    }
+
+    double mpts = static_cast<double>(count) / 1e6;
+    printf("Points:         %zu (%0.1f km)\n", count, scalarTotal);
+    printf("Scalar:         %0.2fms, %0.1f Mpts/s\n", scalarTime * 1000.0, mpts / scalarTime);
+    printf("%-15s %0.2fms, %0.1f Mpts/s (%0.1fx)\n",
+        hasAVX2() ? "AVX2:" : "Dispatched:",
+        time * 1000.0,
+        mpts / time,
+        scalarTime / time);
+    printf("Max error:      %0.3g mm per segment, %0.3g mm in total\n",
+        maxError * 1e6,
+        abs(total - scalarTotal) * 1e6);
+
+    // A millimetre is far below anything X-Plane or the map could show
+    bool ok = maxError < 1e-6 && abs(cumulative.back() - total) == 0.0;
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+// What Route::project() does on the Web Mercator map, without needing a QGVMap
+static void projectTrack(Track<float>& track, size_t from, const double* latitudes, const double* longitudes)
+{
+    const size_t count = track.size() - from;
+    vector<double> x(count);
+    vector<double> y(count);
+    toWebMercator(latitudes, longitudes, count, x.data(), y.data());
+    if (from == 0 && count > 0)
+    {
+        track.setProjectionOrigin(x[0], y[0]);
+    }
+    track.setProjected(from, x.data(), y.data(), count);
+}
+
+// The UI adds whatever's new to the live route every second, which at cruise is one state a second.
+// Runs the same Track and projection as Route::addPoints() for each of them, and compares it with
+// reprojecting the whole route every time like Route::onProjection() does.
+int benchmarkRoute(double hours)
+{
+    const auto count = static_cast<size_t>(hours * 3600.0);
+    if (count < 2)
+    {
+        printf("Need at least 2 seconds\n");
+        return 1;
+    }
+
+    // Heathrow to the west at 450 knots, weaving a bit
+    vector<double> latitudes(count);
+    vector<double> longitudes(count);
+    vector<float> headings(count);
+    UFC::Coordinate position;
+    position.latitude = 51.47;
+    position.longitude = -0.4543;
+    for (size_t i = 0; i < count; i++)
+    {
+        latitudes[i] = position.latitude;
+        longitudes[i] = position.longitude;
+        double heading = 270.0 + 20.0 * sin(static_cast<double>(i) / 600.0);
+        headings[i] = static_cast<float>(heading);
+        position = destination(position, heading, 450.0 / KM_TO_NM / 3600.0);
+    }
+    const float altitude = 35000.0f;
+
+    auto startTime = chrono::steady_clock::now();
+    double slowestFull = 0.0;
+    Track<float> fullTrack;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto updateStart = chrono::steady_clock::now();
+        fullTrack.append(&latitudes[i], &longitudes[i], &altitude, &headings[i], 1);
+
+        // Route only keeps the positions as floats, so that's what it reprojects from
+        vector<double> trackLatitudes(fullTrack.getLatitudes(), fullTrack.getLatitudes() + fullTrack.size());
+        vector<double> trackLongitudes(fullTrack.getLongitudes(), fullTrack.getLongitudes() + fullTrack.size());
+        projectTrack(fullTrack, 0, trackLatitudes.data(), trackLongitudes.data());
+        slowestFull = max(slowestFull, chrono::duration<double, milli>(chrono::steady_clock::now() - updateStart).count());
+    }
+    double fullTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    startTime = chrono::steady_clock::now();
+    double slowestIncremental = 0.0;
+    Track<float> track;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto updateStart = chrono::steady_clock::now();
+        const size_t added = track.size();
+        track.append(&latitudes[i], &longitudes[i], &altitude, &headings[i], 1);
+        projectTrack(track, added, &latitudes[i], &longitudes[i]);
+        slowestIncremental = max(slowestIncremental, chrono::duration<double, milli>(chrono::steady_clock::now() - updateStart).count());
+    }
+    double incrementalTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    // The full version projects from the stored floats, so they won't match exactly
+    double maxError = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        maxError = max(maxError, abs(track.getProjectedX(i) - fullTrack.getProjectedX(i)));
+        maxError = max(maxError, abs(track.getProjectedY(i) - fullTrack.getProjectedY(i)));
+    }
+    const GeoBounds& bounds = track.getBounds();
+    const GeoBounds& fullBounds = fullTrack.getBounds();
+
+    printf("Live flight:    %0.1f hours, %zu updates of one point, %zu KB of track\n",
+        hours, count, count * Track<float>::BYTES_PER_POINT / 1024);
+    printf("Full:           %0.3f seconds in total, slowest update %0.3fms\n", fullTime, slowestFull);
+    printf("Incremental:    %0.3f seconds in total, slowest update %0.3fms\n", incrementalTime, slowestIncremental);
+    printf("Difference:     %0.3fm at most\n", maxError);
+
+    // Well under a pixel at any zoom the route is drawn at
+    bool ok = maxError < 1.0 && track.getTotalDistance() == fullTrack.getTotalDistance() &&
+        bounds.minLatitude == fullBounds.minLatitude && bounds.maxLatitude == fullBounds.maxLatitude &&
+        bounds.minLongitude == fullBounds.minLongitude && bounds.maxLongitude == fullBounds.maxLongitude;
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int benchmarkProjection(size_t count)
+{
+    if (count == 0)
+    {
+        printf("Need at least 1 point\n");
+        return 1;
+    }
+
+    // Everywhere, including past where Mercator gets clamped
+    mt19937_64 random(1);
+    uniform_real_distribution<double> latitude(-89.0, 89.0);
+    uniform_real_distribution<double> longitude(-180.0, 180.0);
+    vector<double> latitudes(count);
+    vector<double> longitudes(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        latitudes[i] = latitude(random);
+        longitudes[i] = longitude(random);
+    }
+
+    vector<double> expectedX(count);
+    vector<double> expectedY(count);
+    vector<double> x(count);
+    vector<double> y(count);
+
+    const int runs = 10;
+    auto startTime = chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++)
+    {
+        toWebMercatorScalar(latitudes.data(), longitudes.data(), count, expectedX.data(), expectedY.data());
+    }
+    double scalarTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count() / runs;
+
+    startTime = chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++)
+    {
+        toWebMercator(latitudes.data(), longitudes.data(), count, x.data(), y.data());
+    }
+    double time = chrono::duration<double>(chrono::steady_clock::now() - startTime).count() / runs;
+
+    double maxError = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        maxError = max(maxError, max(abs(x[i] - expectedX[i]), abs(y[i] - expectedY[i])));
+    }
+
+    double mpts = static_cast<double>(count) / 1e6;
+    printf("Points:         %zu\n", count);
+    printf("Scalar:         %0.2fms, %0.1f Mpts/s\n", scalarTime * 1000.0, mpts / scalarTime);
+    printf("%-15s %0.2fms, %0.1f Mpts/s (%0.1fx)\n",
+        hasAVX2() ? "AVX2:" : "Dispatched:",
+        time * 1000.0,
+        mpts / time,
+        scalarTime / time);
+    printf("Max error:      %0.3g mm\n", maxError * 1000.0);
+
+    // Far less than a pixel at any zoom level the tiles go to
+    bool ok = maxError < 1e-3;
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    string pluginPath;
+    filesystem::path outputDir = "headless";
+    double fps = 60.0;
+    double cruiseTime = 3600.0;
+    string replayPath;
+    bool verbose = false;
+
+    Simulator& sim = Simulator::instance();
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--output" && hasValue)
+        {
+            outputDir = argv[++i];
+        }
+        else if (arg == "--fps" && hasValue)
+        {
+            fps = atof(argv[++i]);
+        }
+        else if (arg == "--cruise" && hasValue)
+        {
+            cruiseTime = atof(argv[++i]);
+        }
+        else if (arg == "--replay" && hasValue)
+        {
+            replayPath = argv[++i];
+        }
+        else if (arg == "--airport" && hasValue)
+        {
+            char id[32];
+            float latitude;
+            float longitude;
+            if (sscanf(argv[++i], "%31[^,],%f,%f", id, &latitude, &longitude) != 3)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            sim.addNavAid(xplm_Nav_Airport, id, id, latitude, longitude);
+        }
+        else if (arg == "--verbose")
+        {
+            verbose = true;
+        }
+        else if (arg == "--benchmark-distance" && hasValue)
+        {
+            return benchmarkDistance(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--benchmark-route" && hasValue)
+        {
+            return benchmarkRoute(atof(argv[++i]));
+        }
+        else if (arg == "--benchmark-projection" && hasValue)
+        {
+            return benchmarkProjection(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg[0] != '-' && pluginPath.empty())
+        {
+            pluginPath = arg;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (pluginPath.empty() || fps <= 0.0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    unique_ptr<Script> script;
+    if (!replayPath.empty())
+    {
+        auto recorded = make_unique<RecordedScript>();
+        if (!recorded->load(replayPath))
+        {
+            printf("Failed to load %s\n", replayPath.c_str());
+            return 1;
+        }
+        script = std::move(recorded);
+    }
+    else
+    {
+        // Heathrow heading east
+        auto flight = make_unique<ScriptedFlight>(51.4700, -0.4543, cruiseTime);
+        double latitude;
+        double longitude;
+        flight->getDestination(latitude, longitude);
+        sim.addNavAid(xplm_Nav_Airport, "EGLL", "London Heathrow", 51.4700f, -0.4543f);
+        sim.addNavAid(xplm_Nav_Airport, "DEST", "Destination", static_cast<float>(latitude), static_cast<float>(longitude));
+        script = std::move(flight);
+    }
+
+    filesystem::create_directories(outputDir / "Output");
+    sim.setSystemPath(filesystem::absolute(outputDir).string() + "/");
+    sim.setQuiet(!verbose);
+
+    void* plugin = dlopen(pluginPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (plugin == nullptr)
+    {
+        printf("Failed to load plugin: %s\n", dlerror());
+        return 1;
+    }
+
+    auto pluginStart = reinterpret_cast<XPluginStart_f>(dlsym(plugin, "XPluginStart"));
+    auto pluginStop = reinterpret_cast<XPluginStop_f>(dlsym(plugin, "XPluginStop"));
+    auto pluginEnable = reinterpret_cast<XPluginEnable_f>(dlsym(plugin, "XPluginEnable"));
+    auto pluginDisable = reinterpret_cast<XPluginDisable_f>(dlsym(plugin, "XPluginDisable"));
+    auto pluginReceiveMessage = reinterpret_cast<XPluginReceiveMessage_f>(dlsym(plugin, "XPluginReceiveMessage"));
+    if (pluginStart == nullptr || pluginStop == nullptr || pluginEnable == nullptr || pluginDisable == nullptr || pluginReceiveMessage == nullptr)
+    {
+        printf("%s is not an X-Plane plugin\n", pluginPath.c_str());
+        return 1;
+    }
+
+    script->apply(sim, 0.0);
+
+    char name[256];
+    char sig[256];
+    char desc[256];
+    if (!pluginStart(name, sig, desc) || !pluginEnable())
+    {
+        printf("Failed to start plugin\n");
+        return 1;
+    }
+    printf("Loaded plugin: %s (%s)\n", name, sig);
+
+    pluginReceiveMessage(XPLM_PLUGIN_XPLANE, XPLM_MSG_AIRPORT_LOADED, nullptr);
+
+    double frameTime = 1.0 / fps;
+    double duration = script->getDuration();
+    auto frames = static_cast<size_t>(duration * fps);
+    if (frames == 0)
+    {
+        printf("Nothing to simulate\n");
+        return 1;
+    }
+
+    vector<float> latencies;
+    latencies.reserve(frames);
+
+    auto startTime = chrono::steady_clock::now();
+    for (size_t frame = 1; frame <= frames; frame++)
+    {
+        script->apply(sim, static_cast<double>(frame) * frameTime);
+
+        auto frameStart = chrono::steady_clock::now();
+        sim.runFrame(frameTime);
+        latencies.push_back(chrono::duration<float, micro>(chrono::steady_clock::now() - frameStart).count());
+    }
+    auto simTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    // Read these before the plugin unregisters them
+    double queueDepth = sim.get("blackbox/recorder/queue_depth");
+    double commitLatency = sim.get("blackbox/recorder/commit_latency_ms");
+
+    auto drainStart = chrono::steady_clock::now();
+    pluginDisable();
+    auto drainTime = chrono::duration<double, milli>(chrono::steady_clock::now() - drainStart).count();
+
+    double bytesWritten = sim.get("blackbox/recorder/bytes_written");
+    double dropped = sim.get("blackbox/recorder/dropped_samples");
+    pluginStop();
+
+    DataStore dataStore;
+    if (!dataStore.init((outputDir / "Output" / "blackbox" / "blackbox.db").string()))
+    {
+        return 1;
+    }
+    auto flights = dataStore.fetchFlights();
+    size_t samples = 0;
+    if (!flights.empty())
+    {
+        samples = dataStore.fetchUpdates(flights.back().id, 0).size();
+    }
+
+    printf("\n");
+    printf("Simulated:      %0.0f seconds, %zu frames at %0.0f fps\n", duration, frames, fps);
+    printf("Wall time:      %0.3f seconds (%0.0fx real time)\n", simTime, duration / simTime);
+    printf("Frame rate:     %0.0f frames/second\n", static_cast<double>(frames) / simTime);
+    printf("Flight loop:    p50=%0.2fus, p99=%0.2fus, max=%0.2fus\n",
+        percentile(latencies, 0.5f),
+        percentile(latencies, 0.99f),
+        *max_element(latencies.begin(), latencies.end()));
+    printf("Writer:         last commit=%0.2fms, queue depth at end=%0.0f, drain on disable=%0.2fms\n",
+        commitLatency,
+        queueDepth,
+        drainTime);
+    printf("Recorded:       %zu samples in flight %llu, %0.0f dropped, %0.1fKB written\n",
+        samples,
+        flights.empty() ? 0ULL : static_cast<unsigned long long>(flights.back().id),
+        dropped,
+        bytesWritten / 1024.0);
+    return 0;
+}
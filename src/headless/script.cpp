@@ -0,0 +1,193 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "script.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+constexpr double FEET_TO_METRES = 0.3048;
+constexpr double KNOTS_TO_MS = 0.514444;
+
+ScriptedFlight::ScriptedFlight(double latitude, double longitude, double cruiseTime) :
+    m_startLatitude(latitude),
+    m_startLongitude(longitude),
+    m_latitude(latitude),
+    m_longitude(longitude)
+{
+    m_segments = {
+        // Parked at the gate
+        {60.0, 0.0f, 0.0f, 0.0f, true, true},
+        // Taxi out
+        {300.0, 15.0f, 15.0f, 0.0f, true, false},
+        // Take off roll
+        {40.0, 15.0f, 150.0f, 0.0f, true, false},
+        // Climb to 10,000 feet
+        {300.0, 150.0f, 250.0f, 2000.0f, false, false},
+        {cruiseTime, 450.0f, 450.0f, 0.0f, false, false},
+        // Descend to 1,000 feet
+        {450.0, 300.0f, 160.0f, -1200.0f, false, false},
+        // Final approach
+        {100.0, 160.0f, 140.0f, -600.0f, false, false},
+        // Roll out
+        {40.0, 140.0f, 15.0f, 0.0f, true, false},
+        // Taxi in
+        {120.0, 15.0f, 15.0f, 0.0f, true, false},
+        {60.0, 0.0f, 0.0f, 0.0f, true, true},
+    };
+}
+
+double ScriptedFlight::getDuration() const
+{
+    double duration = 0.0;
+    for (const FlightSegment& segment : m_segments)
+    {
+        duration += segment.duration;
+    }
+    return duration;
+}
+
+const FlightSegment& ScriptedFlight::advance(double time, float& speed)
+{
+    double start = 0.0;
+    const FlightSegment* current = &m_segments.back();
+    for (const FlightSegment& segment : m_segments)
+    {
+        if (time < start + segment.duration)
+        {
+            current = &segment;
+            break;
+        }
+        start += segment.duration;
+    }
+
+    double progress = current->duration > 0.0 ? (time - start) / current->duration : 1.0;
+    progress = clamp(progress, 0.0, 1.0);
+    speed = static_cast<float>(current->startSpeed + (current->endSpeed - current->startSpeed) * progress);
+
+    double dt = time - m_time;
+    m_time = time;
+
+    m_altitude += (current->fpm / 60.0) * dt;
+    if (m_altitude < 0.0 || current->onGround)
+    {
+        m_altitude = 0.0;
+    }
+
+    // Heading east, so only the longitude changes
+    double nm = (speed / 3600.0) * dt;
+    m_longitude += (nm / 60.0) / cos(m_latitude * M_PI / 180.0);
+    return *current;
+}
+
+void ScriptedFlight::apply(Simulator& sim, double time)
+{
+    float speed;
+    const FlightSegment& segment = advance(time, speed);
+
+    sim.set("sim/aircraft/view/acf_ICAO", string("B738"));
+    sim.set("sim/cockpit2/tcas/targets/flight_id", string("BBX123"));
+    sim.set("sim/time/paused", 0.0);
+    sim.set("sim/time/is_in_replay", 0.0);
+    sim.set("sim/time/local_time_sec", time);
+
+    sim.set("sim/flightmodel/position/latitude", m_latitude);
+    sim.set("sim/flightmodel/position/longitude", m_longitude);
+    sim.set("sim/flightmodel/position/elevation", m_altitude * FEET_TO_METRES);
+    sim.set("sim/flightmodel/position/y_agl", m_altitude * FEET_TO_METRES);
+    sim.set("sim/flightmodel/position/groundspeed", speed * KNOTS_TO_MS);
+    sim.set("sim/flightmodel/position/indicated_airspeed", speed);
+    sim.set("sim/flightmodel/position/vh_ind_fpm", segment.onGround ? 0.0f : segment.fpm);
+    sim.set("sim/flightmodel/position/true_theta", segment.fpm > 0.0f ? 7.5 : 0.0);
+    sim.set("sim/flightmodel/position/true_phi", 0.0);
+    sim.set("sim/flightmodel/position/true_psi", 90.0);
+    sim.set("sim/flightmodel2/misc/gforce_normal", 1.0);
+
+    sim.set("sim/flightmodel/controls/parkbrake", segment.parkingBrake ? 1.0 : 0.0);
+    sim.set("sim/flightmodel/failures/onground_any", segment.onGround ? 1.0 : 0.0);
+    sim.set("sim/flightmodel/failures/onground_all", segment.onGround ? 1.0 : 0.0);
+}
+
+void ScriptedFlight::getDestination(double& latitude, double& longitude)
+{
+    ScriptedFlight flight(m_startLatitude, m_startLongitude, 0.0);
+    flight.m_segments = m_segments;
+
+    float speed;
+    double duration = getDuration();
+    for (double time = 0.0; time <= duration; time += 1.0)
+    {
+        flight.advance(time, speed);
+    }
+    latitude = flight.m_latitude;
+    longitude = flight.m_longitude;
+}
+
+bool RecordedScript::load(const string& path)
+{
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    string line;
+    if (!getline(file, line))
+    {
+        return false;
+    }
+
+    stringstream header(line);
+    string name;
+    getline(header, name, ','); // time
+    while (getline(header, name, ','))
+    {
+        m_dataRefs.push_back(name);
+    }
+
+    while (getline(file, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+
+        vector<double> row;
+        stringstream values(line);
+        string value;
+        while (getline(values, value, ','))
+        {
+            row.push_back(strtod(value.c_str(), nullptr));
+        }
+        if (row.size() != m_dataRefs.size() + 1)
+        {
+            return false;
+        }
+        m_rows.push_back(std::move(row));
+    }
+    return !m_rows.empty();
+}
+
+double RecordedScript::getDuration() const
+{
+    return m_rows.empty() ? 0.0 : m_rows.back()[0];
+}
+
+void RecordedScript::apply(Simulator& sim, double time)
+{
+    while (m_row + 1 < m_rows.size() && m_rows[m_row + 1][0] <= time)
+    {
+        m_row++;
+    }
+
+    const vector<double>& row = m_rows[m_row];
+    for (size_t i = 0; i < m_dataRefs.size(); i++)
+    {
+        sim.set(m_dataRefs[i], row[i + 1]);
+    }
+}
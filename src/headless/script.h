@@ -0,0 +1,76 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_SCRIPT_H
+#define BLACKBOX_SCRIPT_H
+
+#include <string>
+#include <vector>
+
+#include "simulator.h"
+
+// Feeds datarefs in to the Simulator as the sim time moves on
+class Script
+{
+ public:
+    virtual ~Script() = default;
+
+    [[nodiscard]] virtual double getDuration() const = 0;
+    virtual void apply(Simulator& sim, double time) = 0;
+};
+
+struct FlightSegment
+{
+    double duration;
+    float startSpeed; // knots
+    float endSpeed;
+    float fpm;
+    bool onGround;
+    bool parkingBrake;
+};
+
+// A complete gate to gate flight, heading east from the origin
+class ScriptedFlight : public Script
+{
+    std::vector<FlightSegment> m_segments;
+
+    double m_startLatitude;
+    double m_startLongitude;
+
+    double m_time = 0.0;
+    double m_latitude;
+    double m_longitude;
+    double m_altitude = 0.0; // feet
+
+    const FlightSegment& advance(double time, float& speed);
+
+ public:
+    ScriptedFlight(double latitude, double longitude, double cruiseTime);
+    ~ScriptedFlight() override = default;
+
+    [[nodiscard]] double getDuration() const override;
+    void apply(Simulator& sim, double time) override;
+
+    // Where apply() will end up, so there's an airport to land at
+    void getDestination(double& latitude, double& longitude);
+};
+
+// Replays a CSV file with a header of "time,<dataref>,<dataref>,..."
+class RecordedScript : public Script
+{
+    std::vector<std::string> m_dataRefs;
+    std::vector<std::vector<double>> m_rows;
+    size_t m_row = 0;
+
+ public:
+    RecordedScript() = default;
+    ~RecordedScript() override = default;
+
+    bool load(const std::string& path);
+
+    [[nodiscard]] double getDuration() const override;
+    void apply(Simulator& sim, double time) override;
+};
+
+#endif //BLACKBOX_SCRIPT_H
@@ -0,0 +1,205 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+using namespace BlackBox;
+
+Simulator::Simulator() : Logger("Simulator")
+{
+}
+
+Simulator& Simulator::instance()
+{
+    static Simulator simulator;
+    return simulator;
+}
+
+SimDataRef* Simulator::findDataRef(const string& name)
+{
+    // Unlike X-Plane, every dataref exists so scripts can feed anything in
+    auto it = m_dataRefs.find(name);
+    if (it != m_dataRefs.end())
+    {
+        return it->second.get();
+    }
+
+    auto dataRef = make_unique<SimDataRef>();
+    dataRef->name = name;
+    SimDataRef* ptr = dataRef.get();
+    m_dataRefs.emplace(name, std::move(dataRef));
+    return ptr;
+}
+
+SimDataRef* Simulator::registerDataRef(const string& name)
+{
+    SimDataRef* dataRef = findDataRef(name);
+    if (dataRef->owned)
+    {
+        log(WARN, "registerDataRef: %s is already registered", name.c_str());
+    }
+    dataRef->owned = true;
+    return dataRef;
+}
+
+void Simulator::unregisterDataRef(SimDataRef* dataRef)
+{
+    if (dataRef == nullptr)
+    {
+        return;
+    }
+    dataRef->owned = false;
+    dataRef->readInt = nullptr;
+    dataRef->readFloat = nullptr;
+    dataRef->readDouble = nullptr;
+    dataRef->readData = nullptr;
+    dataRef->refcon = nullptr;
+}
+
+void Simulator::set(const string& name, double value)
+{
+    findDataRef(name)->value = value;
+}
+
+void Simulator::set(const string& name, const string& value)
+{
+    findDataRef(name)->bytes = value;
+}
+
+double Simulator::get(const string& name)
+{
+    SimDataRef* dataRef = findDataRef(name);
+    if (dataRef->readDouble != nullptr)
+    {
+        return dataRef->readDouble(dataRef->refcon);
+    }
+    if (dataRef->readFloat != nullptr)
+    {
+        return dataRef->readFloat(dataRef->refcon);
+    }
+    if (dataRef->readInt != nullptr)
+    {
+        return dataRef->readInt(dataRef->refcon);
+    }
+    return dataRef->value;
+}
+
+SimFlightLoop* Simulator::createFlightLoop(XPLMFlightLoop_f callback, void* refcon)
+{
+    auto flightLoop = make_unique<SimFlightLoop>();
+    flightLoop->callback = callback;
+    flightLoop->refcon = refcon;
+    flightLoop->lastCallTime = m_elapsedTime;
+
+    SimFlightLoop* ptr = flightLoop.get();
+    m_flightLoops.push_back(std::move(flightLoop));
+    return ptr;
+}
+
+void Simulator::scheduleFlightLoop(SimFlightLoop* flightLoop, float interval, bool relativeToNow)
+{
+    flightLoop->interval = interval;
+    if (interval > 0.0f)
+    {
+        double base = relativeToNow ? m_elapsedTime : flightLoop->lastCallTime;
+        flightLoop->nextCallTime = base + interval;
+    }
+    else if (interval < 0.0f)
+    {
+        flightLoop->nextCallFrame = m_frame + static_cast<int>(-interval);
+    }
+}
+
+void Simulator::destroyFlightLoop(SimFlightLoop* flightLoop)
+{
+    erase_if(m_flightLoops, [flightLoop](const unique_ptr<SimFlightLoop>& loop) { return loop.get() == flightLoop; });
+}
+
+void Simulator::runFrame(double frameTime)
+{
+    m_frame++;
+    m_elapsedTime += frameTime;
+
+    // Callbacks may create or destroy flight loops
+    vector<SimFlightLoop*> due;
+    for (const auto& flightLoop : m_flightLoops)
+    {
+        if ((flightLoop->interval > 0.0f && m_elapsedTime >= flightLoop->nextCallTime) ||
+            (flightLoop->interval < 0.0f && m_frame >= flightLoop->nextCallFrame))
+        {
+            due.push_back(flightLoop.get());
+        }
+    }
+
+    for (SimFlightLoop* flightLoop : due)
+    {
+        auto it = find_if(m_flightLoops.begin(), m_flightLoops.end(), [flightLoop](const unique_ptr<SimFlightLoop>& loop)
+        {
+            return loop.get() == flightLoop;
+        });
+        if (it == m_flightLoops.end())
+        {
+            continue;
+        }
+
+        auto sinceLastCall = static_cast<float>(m_elapsedTime - flightLoop->lastCallTime);
+        auto sinceLastLoop = static_cast<float>(m_elapsedTime - m_lastFrameTime);
+        float next = flightLoop->callback(sinceLastCall, sinceLastLoop, m_frame, flightLoop->refcon);
+        flightLoop->lastCallTime = m_elapsedTime;
+        scheduleFlightLoop(flightLoop, next, true);
+    }
+
+    m_lastFrameTime = m_elapsedTime;
+}
+
+void Simulator::addNavAid(XPLMNavType type, const string& id, const string& name, float latitude, float longitude)
+{
+    m_navAids.push_back({type, id, name, latitude, longitude});
+}
+
+XPLMNavRef Simulator::findNavAid(const float* latitude, const float* longitude, XPLMNavType type) const
+{
+    XPLMNavRef found = XPLM_NAV_NOT_FOUND;
+    float bestDistance = INFINITY;
+    for (size_t i = 0; i < m_navAids.size(); i++)
+    {
+        const SimNavAid& navAid = m_navAids[i];
+        if ((navAid.type & type) == 0)
+        {
+            continue;
+        }
+
+        if (latitude == nullptr || longitude == nullptr)
+        {
+            // X-Plane returns the last match when there's no position
+            found = static_cast<XPLMNavRef>(i);
+            continue;
+        }
+
+        // Only used to compare, so no need to be accurate
+        float dLat = navAid.latitude - *latitude;
+        float dLon = (navAid.longitude - *longitude) * cosf(*latitude * static_cast<float>(M_PI) / 180.0f);
+        float distance = dLat * dLat + dLon * dLon;
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            found = static_cast<XPLMNavRef>(i);
+        }
+    }
+    return found;
+}
+
+const SimNavAid* Simulator::getNavAid(XPLMNavRef ref) const
+{
+    if (ref < 0 || static_cast<size_t>(ref) >= m_navAids.size())
+    {
+        return nullptr;
+    }
+    return &m_navAids[ref];
+}
@@ -0,0 +1,110 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_SIMULATOR_H
+#define BLACKBOX_SIMULATOR_H
+
+#define XPLM200 1
+#define XPLM210 1
+#define XPLM300 1
+#define XPLM301 1
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <XPLMDataAccess.h>
+#include <XPLMNavigation.h>
+#include <XPLMProcessing.h>
+
+#include "blackbox/logger.h"
+
+struct SimDataRef
+{
+    std::string name;
+    double value = 0.0;
+    std::string bytes;
+
+    // Set for datarefs registered by plugins
+    bool owned = false;
+    XPLMGetDatai_f readInt = nullptr;
+    XPLMGetDataf_f readFloat = nullptr;
+    XPLMGetDatad_f readDouble = nullptr;
+    XPLMGetDatab_f readData = nullptr;
+    void* refcon = nullptr;
+};
+
+struct SimFlightLoop
+{
+    XPLMFlightLoop_f callback = nullptr;
+    void* refcon = nullptr;
+
+    // Same convention as X-Plane: > 0 is seconds, < 0 is frames, 0 is not scheduled
+    float interval = 0.0f;
+    double nextCallTime = 0.0;
+    int nextCallFrame = 0;
+    double lastCallTime = 0.0;
+};
+
+struct SimNavAid
+{
+    XPLMNavType type;
+    std::string id;
+    std::string name;
+    float latitude;
+    float longitude;
+};
+
+// Stands in for the parts of X-Plane the plugin talks to, so it can be driven without a sim
+class Simulator : BlackBox::Logger
+{
+    std::map<std::string, std::unique_ptr<SimDataRef>> m_dataRefs;
+    std::vector<std::unique_ptr<SimFlightLoop>> m_flightLoops;
+    std::vector<SimNavAid> m_navAids;
+
+    std::string m_systemPath;
+    bool m_quiet = false;
+
+    double m_elapsedTime = 0.0;
+    double m_lastFrameTime = 0.0;
+    int m_frame = 0;
+
+ public:
+    Simulator();
+    ~Simulator() override = default;
+
+    static Simulator& instance();
+
+    void setSystemPath(const std::string& path) { m_systemPath = path; }
+    [[nodiscard]] const std::string& getSystemPath() const { return m_systemPath; }
+
+    void setQuiet(bool quiet) { m_quiet = quiet; }
+    [[nodiscard]] bool isQuiet() const { return m_quiet; }
+
+    // Data refs
+    SimDataRef* findDataRef(const std::string& name);
+    SimDataRef* registerDataRef(const std::string& name);
+    void unregisterDataRef(SimDataRef* dataRef);
+
+    void set(const std::string& name, double value);
+    void set(const std::string& name, const std::string& value);
+    double get(const std::string& name);
+
+    // Flight loops
+    SimFlightLoop* createFlightLoop(XPLMFlightLoop_f callback, void* refcon);
+    void scheduleFlightLoop(SimFlightLoop* flightLoop, float interval, bool relativeToNow);
+    void destroyFlightLoop(SimFlightLoop* flightLoop);
+
+    // Advances the sim by frameTime and calls any flight loops that are due
+    void runFrame(double frameTime);
+    [[nodiscard]] double getElapsedTime() const { return m_elapsedTime; }
+
+    // Navigation
+    void addNavAid(XPLMNavType type, const std::string& id, const std::string& name, float latitude, float longitude);
+    XPLMNavRef findNavAid(const float* latitude, const float* longitude, XPLMNavType type) const;
+    const SimNavAid* getNavAid(XPLMNavRef ref) const;
+};
+
+#endif //BLACKBOX_SIMULATOR_H
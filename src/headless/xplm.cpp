@@ -0,0 +1,371 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+// Just enough of the XPLM API for the BlackBox plugin, backed by Simulator
+//
+
+#include "simulator.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <XPLMDisplay.h>
+#include <XPLMGraphics.h>
+#include <XPLMMenus.h>
+#include <XPLMPlugin.h>
+#include <XPLMUtilities.h>
+
+using namespace std;
+
+struct SimWindow
+{
+    std::string title;
+    bool visible = false;
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+};
+
+static int g_nextMenuItem = 0;
+
+// Utilities
+
+XPLM_API void XPLMDebugString(const char* inString)
+{
+    if (!Simulator::instance().isQuiet())
+    {
+        fputs(inString, stdout);
+    }
+}
+
+XPLM_API void XPLMEnableFeature(const char* inFeature, int inEnable)
+{
+}
+
+XPLM_API void XPLMGetSystemPath(char* outSystemPath)
+{
+    // X-Plane says the buffer should be at least 512 bytes
+    snprintf(outSystemPath, 512, "%s", Simulator::instance().getSystemPath().c_str());
+}
+
+// Data access
+
+XPLM_API XPLMDataRef XPLMFindDataRef(const char* inDataRefName)
+{
+    return Simulator::instance().findDataRef(inDataRefName);
+}
+
+XPLM_API int XPLMGetDatai(XPLMDataRef inDataRef)
+{
+    auto dataRef = static_cast<SimDataRef*>(inDataRef);
+    if (dataRef->readInt != nullptr)
+    {
+        return dataRef->readInt(dataRef->refcon);
+    }
+    return static_cast<int>(Simulator::instance().get(dataRef->name));
+}
+
+XPLM_API float XPLMGetDataf(XPLMDataRef inDataRef)
+{
+    auto dataRef = static_cast<SimDataRef*>(inDataRef);
+    if (dataRef->readFloat != nullptr)
+    {
+        return dataRef->readFloat(dataRef->refcon);
+    }
+    return static_cast<float>(Simulator::instance().get(dataRef->name));
+}
+
+XPLM_API double XPLMGetDatad(XPLMDataRef inDataRef)
+{
+    auto dataRef = static_cast<SimDataRef*>(inDataRef);
+    return Simulator::instance().get(dataRef->name);
+}
+
+XPLM_API int XPLMGetDatab(XPLMDataRef inDataRef, void* outValue, int inOffset, int inMaxBytes)
+{
+    auto dataRef = static_cast<SimDataRef*>(inDataRef);
+    if (dataRef->readData != nullptr)
+    {
+        return dataRef->readData(dataRef->refcon, outValue, inOffset, inMaxBytes);
+    }
+
+    int size = static_cast<int>(dataRef->bytes.size());
+    if (outValue == nullptr)
+    {
+        return size;
+    }
+    if (inOffset >= size)
+    {
+        return 0;
+    }
+    int bytes = min(size - inOffset, inMaxBytes);
+    memcpy(outValue, dataRef->bytes.data() + inOffset, bytes);
+    return bytes;
+}
+
+XPLM_API XPLMDataRef XPLMRegisterDataAccessor(
+    const char* inDataName,
+    XPLMDataTypeID inDataType,
+    int inIsWritable,
+    XPLMGetDatai_f inReadInt,
+    XPLMSetDatai_f inWriteInt,
+    XPLMGetDataf_f inReadFloat,
+    XPLMSetDataf_f inWriteFloat,
+    XPLMGetDatad_f inReadDouble,
+    XPLMSetDatad_f inWriteDouble,
+    XPLMGetDatavi_f inReadIntArray,
+    XPLMSetDatavi_f inWriteIntArray,
+    XPLMGetDatavf_f inReadFloatArray,
+    XPLMSetDatavf_f inWriteFloatArray,
+    XPLMGetDatab_f inReadData,
+    XPLMSetDatab_f inWriteData,
+    void* inReadRefcon,
+    void* inWriteRefcon)
+{
+    SimDataRef* dataRef = Simulator::instance().registerDataRef(inDataName);
+    dataRef->readInt = inReadInt;
+    dataRef->readFloat = inReadFloat;
+    dataRef->readDouble = inReadDouble;
+    dataRef->readData = inReadData;
+    dataRef->refcon = inReadRefcon;
+    return dataRef;
+}
+
+XPLM_API void XPLMUnregisterDataAccessor(XPLMDataRef inDataRef)
+{
+    Simulator::instance().unregisterDataRef(static_cast<SimDataRef*>(inDataRef));
+}
+
+// Processing
+
+XPLM_API float XPLMGetElapsedTime()
+{
+    return static_cast<float>(Simulator::instance().getElapsedTime());
+}
+
+XPLM_API XPLMFlightLoopID XPLMCreateFlightLoop(XPLMCreateFlightLoop_t* inParams)
+{
+    return Simulator::instance().createFlightLoop(inParams->callbackFunc, inParams->refcon);
+}
+
+XPLM_API void XPLMScheduleFlightLoop(XPLMFlightLoopID inFlightLoopID, float inInterval, int inRelativeToNow)
+{
+    Simulator::instance().scheduleFlightLoop(static_cast<SimFlightLoop*>(inFlightLoopID), inInterval, inRelativeToNow);
+}
+
+XPLM_API void XPLMDestroyFlightLoop(XPLMFlightLoopID inFlightLoopID)
+{
+    Simulator::instance().destroyFlightLoop(static_cast<SimFlightLoop*>(inFlightLoopID));
+}
+
+// Navigation
+
+XPLM_API XPLMNavRef XPLMFindNavAid(
+    const char* inNameFragment,
+    const char* inIDFragment,
+    float* inLat,
+    float* inLon,
+    int* inFrequency,
+    XPLMNavType inType)
+{
+    return Simulator::instance().findNavAid(inLat, inLon, inType);
+}
+
+XPLM_API void XPLMGetNavAidInfo(
+    XPLMNavRef inRef,
+    XPLMNavType* outType,
+    float* outLatitude,
+    float* outLongitude,
+    float* outHeight,
+    int* outFrequency,
+    float* outHeading,
+    char* outID,
+    char* outName,
+    char* outReg)
+{
+    const SimNavAid* navAid = Simulator::instance().getNavAid(inRef);
+    if (navAid == nullptr)
+    {
+        return;
+    }
+
+    if (outType != nullptr)
+    {
+        *outType = navAid->type;
+    }
+    if (outLatitude != nullptr)
+    {
+        *outLatitude = navAid->latitude;
+    }
+    if (outLongitude != nullptr)
+    {
+        *outLongitude = navAid->longitude;
+    }
+    if (outID != nullptr)
+    {
+        snprintf(outID, 32, "%s", navAid->id.c_str());
+    }
+    if (outName != nullptr)
+    {
+        snprintf(outName, 256, "%s", navAid->name.c_str());
+    }
+}
+
+// Menus
+
+XPLM_API XPLMMenuID XPLMFindPluginsMenu()
+{
+    static int pluginsMenu;
+    return &pluginsMenu;
+}
+
+XPLM_API XPLMMenuID XPLMCreateMenu(
+    const char* inName,
+    XPLMMenuID inParentMenu,
+    int inParentItem,
+    XPLMMenuHandler_f inHandler,
+    void* inMenuRef)
+{
+    static int menu;
+    return &menu;
+}
+
+XPLM_API int XPLMAppendMenuItem(XPLMMenuID inMenu, const char* inItemName, void* inItemRef, int inDeprecatedAndIgnored)
+{
+    return g_nextMenuItem++;
+}
+
+XPLM_API void XPLMCheckMenuItem(XPLMMenuID inMenu, int index, XPLMMenuCheck inCheck)
+{
+}
+
+// Windows, which are never drawn
+
+XPLM_API XPLMWindowID XPLMCreateWindowEx(XPLMCreateWindow_t* inParams)
+{
+    auto window = new SimWindow();
+    window->left = inParams->left;
+    window->top = inParams->top;
+    window->right = inParams->right;
+    window->bottom = inParams->bottom;
+    window->visible = inParams->visible;
+    return window;
+}
+
+XPLM_API void XPLMDestroyWindow(XPLMWindowID inWindowID)
+{
+    delete static_cast<SimWindow*>(inWindowID);
+}
+
+XPLM_API void XPLMSetWindowIsVisible(XPLMWindowID inWindowID, int inIsVisible)
+{
+    if (inWindowID != nullptr)
+    {
+        static_cast<SimWindow*>(inWindowID)->visible = inIsVisible;
+    }
+}
+
+XPLM_API int XPLMGetWindowIsVisible(XPLMWindowID inWindowID)
+{
+    return inWindowID != nullptr && static_cast<SimWindow*>(inWindowID)->visible;
+}
+
+XPLM_API void XPLMGetWindowGeometry(XPLMWindowID inWindowID, int* outLeft, int* outTop, int* outRight, int* outBottom)
+{
+    auto window = static_cast<SimWindow*>(inWindowID);
+    if (outLeft != nullptr)
+    {
+        *outLeft = window->left;
+    }
+    if (outTop != nullptr)
+    {
+        *outTop = window->top;
+    }
+    if (outRight != nullptr)
+    {
+        *outRight = window->right;
+    }
+    if (outBottom != nullptr)
+    {
+        *outBottom = window->bottom;
+    }
+}
+
+XPLM_API void XPLMSetWindowTitle(XPLMWindowID inWindowID, const char* inWindowTitle)
+{
+    if (inWindowID != nullptr)
+    {
+        static_cast<SimWindow*>(inWindowID)->title = inWindowTitle;
+    }
+}
+
+XPLM_API void XPLMSetWindowPositioningMode(XPLMWindowID inWindowID, XPLMWindowPositioningMode inPositioningMode, int inMonitorIndex)
+{
+}
+
+XPLM_API void XPLMSetWindowGravity(
+    XPLMWindowID inWindowID,
+    float inLeftGravity,
+    float inTopGravity,
+    float inRightGravity,
+    float inBottomGravity)
+{
+}
+
+XPLM_API void XPLMSetWindowResizingLimits(
+    XPLMWindowID inWindowID,
+    int inMinWidthBoxels,
+    int inMinHeightBoxels,
+    int inMaxWidthBoxels,
+    int inMaxHeightBoxels)
+{
+}
+
+XPLM_API void XPLMGetScreenBoundsGlobal(int* outLeft, int* outTop, int* outRight, int* outBottom)
+{
+    if (outLeft != nullptr)
+    {
+        *outLeft = 0;
+    }
+    if (outTop != nullptr)
+    {
+        *outTop = 1080;
+    }
+    if (outRight != nullptr)
+    {
+        *outRight = 1920;
+    }
+    if (outBottom != nullptr)
+    {
+        *outBottom = 0;
+    }
+}
+
+// Graphics
+
+XPLM_API void XPLMGetFontDimensions(XPLMFontID inFontID, int* outCharWidth, int* outCharHeight, int* outDigitsOnly)
+{
+    if (outCharWidth != nullptr)
+    {
+        *outCharWidth = 8;
+    }
+    if (outCharHeight != nullptr)
+    {
+        *outCharHeight = 12;
+    }
+    if (outDigitsOnly != nullptr)
+    {
+        *outDigitsOnly = 0;
+    }
+}
+
+XPLM_API void XPLMDrawString(
+    float* inColorRGB,
+    int inXOffset,
+    int inYOffset,
+    const char* inChar,
+    int* inWordWrapWidth,
+    XPLMFontID inFontID)
+{
+}
@@ -0,0 +1,75 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "datarefs.h"
+
+RecorderDataRefs::~RecorderDataRefs()
+{
+    unregisterDataRefs();
+}
+
+void RecorderDataRefs::registerDataRefs(RecorderStats& stats)
+{
+    registerInt("blackbox/recorder/queue_depth", stats.queueDepth);
+    registerInt("blackbox/recorder/dropped_samples", stats.droppedSamples);
+    registerFloat("blackbox/recorder/commit_latency_ms", stats.commitLatency);
+    registerFloat("blackbox/recorder/samples_per_second", stats.samplesPerSecond);
+    registerDouble("blackbox/recorder/bytes_written", stats.bytesWritten);
+    registerInt("blackbox/recorder/phase", stats.phase);
+    registerFloat("blackbox/recorder/fpm_average", stats.fpmAverage);
+}
+
+void RecorderDataRefs::unregisterDataRefs()
+{
+    for (XPLMDataRef dataRef : m_dataRefs)
+    {
+        XPLMUnregisterDataAccessor(dataRef);
+    }
+    m_dataRefs.clear();
+}
+
+void RecorderDataRefs::registerInt(const char* name, std::atomic<int>& value)
+{
+    m_dataRefs.push_back(XPLMRegisterDataAccessor(
+        name,
+        xplmType_Int,
+        0,
+        readInt, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        &value, nullptr));
+}
+
+void RecorderDataRefs::registerFloat(const char* name, std::atomic<float>& value)
+{
+    m_dataRefs.push_back(XPLMRegisterDataAccessor(
+        name,
+        xplmType_Float,
+        0,
+        nullptr, nullptr,
+        readFloat, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        &value, nullptr));
+}
+
+void RecorderDataRefs::registerDouble(const char* name, std::atomic<double>& value)
+{
+    m_dataRefs.push_back(XPLMRegisterDataAccessor(
+        name,
+        xplmType_Double,
+        0,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        readDouble, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        nullptr, nullptr,
+        &value, nullptr));
+}
@@ -0,0 +1,56 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_DATAREFS_H
+#define BLACKBOX_DATAREFS_H
+
+#include <atomic>
+#include <vector>
+
+#include <XPLMDataAccess.h>
+
+// Written by the sim and writer threads, read by anyone through our datarefs
+struct RecorderStats
+{
+    std::atomic<int> queueDepth = 0;
+    std::atomic<int> droppedSamples = 0;
+    std::atomic<float> commitLatency = 0.0f; // ms
+    std::atomic<float> samplesPerSecond = 0.0f;
+    std::atomic<double> bytesWritten = 0.0;
+    std::atomic<int> phase = 0;
+    std::atomic<float> fpmAverage = 0.0f;
+};
+
+class RecorderDataRefs
+{
+    std::vector<XPLMDataRef> m_dataRefs;
+
+    static int readInt(void* refcon)
+    {
+        return static_cast<std::atomic<int>*>(refcon)->load(std::memory_order_relaxed);
+    }
+
+    static float readFloat(void* refcon)
+    {
+        return static_cast<std::atomic<float>*>(refcon)->load(std::memory_order_relaxed);
+    }
+
+    static double readDouble(void* refcon)
+    {
+        return static_cast<std::atomic<double>*>(refcon)->load(std::memory_order_relaxed);
+    }
+
+    void registerInt(const char* name, std::atomic<int>& value);
+    void registerFloat(const char* name, std::atomic<float>& value);
+    void registerDouble(const char* name, std::atomic<double>& value);
+
+ public:
+    RecorderDataRefs() = default;
+    ~RecorderDataRefs();
+
+    void registerDataRefs(RecorderStats& stats);
+    void unregisterDataRefs();
+};
+
+#endif //BLACKBOX_DATAREFS_H
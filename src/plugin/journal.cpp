@@ -0,0 +1,203 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "journal.h"
+#include "writer.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace std;
+using namespace BlackBox;
+
+constexpr uint32_t JOURNAL_MAGIC = 0x4a424200; // "BBJ\0"
+constexpr uint32_t JOURNAL_VERSION = 1;
+
+// Keep the records page aligned
+constexpr size_t JOURNAL_HEADER_SIZE = 4096;
+
+static_assert(is_trivially_copyable_v<State>, "State is written to the journal with memcpy");
+static_assert(atomic_ref<uint64_t>::is_always_lock_free);
+
+Journal::Journal() : Logger("Journal")
+{
+}
+
+Journal::~Journal()
+{
+    close();
+}
+
+bool Journal::open(const filesystem::path& path, uint64_t flightId, uint32_t capacity)
+{
+    m_path = path;
+
+    bool exists = filesystem::exists(path);
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd == -1)
+    {
+        log(ERROR, "open: Failed to open journal %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    if (exists)
+    {
+        // Use whatever size it was created with
+        JournalHeader header = {};
+        if (pread(m_fd, &header, sizeof(header), 0) != sizeof(header) ||
+            header.magic != JOURNAL_MAGIC ||
+            header.version != JOURNAL_VERSION ||
+            header.recordSize != sizeof(JournalRecord))
+        {
+            log(ERROR, "open: %s is not a valid journal", path.c_str());
+            close();
+            return false;
+        }
+        capacity = header.capacity;
+        flightId = header.flightId;
+    }
+
+    m_mappingSize = JOURNAL_HEADER_SIZE + static_cast<size_t>(capacity) * sizeof(JournalRecord);
+    if (!exists && ftruncate(m_fd, static_cast<off_t>(m_mappingSize)) != 0)
+    {
+        log(ERROR, "open: Failed to allocate journal %s: %s", path.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_mapping == MAP_FAILED)
+    {
+        m_mapping = nullptr;
+        log(ERROR, "open: Failed to map journal %s: %s", path.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+
+    m_header = static_cast<JournalHeader*>(m_mapping);
+    m_records = reinterpret_cast<JournalRecord*>(static_cast<uint8_t*>(m_mapping) + JOURNAL_HEADER_SIZE);
+
+    if (!exists)
+    {
+        // Touch every page now so the sim thread never has to wait for the file system
+        memset(m_mapping, 0, m_mappingSize);
+
+        m_header->magic = JOURNAL_MAGIC;
+        m_header->version = JOURNAL_VERSION;
+        m_header->recordSize = sizeof(JournalRecord);
+        m_header->capacity = capacity;
+        m_header->flightId = flightId;
+        m_header->head = 0;
+        m_header->tail = 0;
+        msync(m_mapping, m_mappingSize, MS_SYNC);
+    }
+
+    log(
+        DEBUG,
+        "open: %s: flightId=%" PRIu64 ", capacity=%u, head=%" PRIu64 ", tail=%" PRIu64,
+        path.c_str(),
+        m_header->flightId,
+        m_header->capacity,
+        m_header->head,
+        m_header->tail);
+    return true;
+}
+
+void Journal::close()
+{
+    if (m_mapping != nullptr)
+    {
+        msync(m_mapping, m_mappingSize, MS_SYNC);
+        munmap(m_mapping, m_mappingSize);
+        m_mapping = nullptr;
+        m_header = nullptr;
+        m_records = nullptr;
+    }
+    if (m_fd != -1)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void Journal::remove()
+{
+    close();
+    error_code ec;
+    filesystem::remove(m_path, ec);
+}
+
+bool Journal::append(const Event& event)
+{
+    if (m_header == nullptr)
+    {
+        return false;
+    }
+
+    uint64_t head = atomic_ref(m_header->head).load(memory_order_relaxed);
+    uint64_t tail = atomic_ref(m_header->tail).load(memory_order_acquire);
+    if (head - tail >= m_header->capacity)
+    {
+        // Full, the writer has fallen behind
+        return false;
+    }
+
+    JournalRecord& record = m_records[head % m_header->capacity];
+    record.flightId = event.flightId;
+    memcpy(&record.state, &event.state, sizeof(State));
+    atomic_ref(record.sequence).store(head + 1, memory_order_release);
+    atomic_ref(m_header->head).store(head + 1, memory_order_release);
+    return true;
+}
+
+uint64_t Journal::read(vector<Event>& events, size_t max)
+{
+    uint64_t head = atomic_ref(m_header->head).load(memory_order_acquire);
+    uint64_t tail = atomic_ref(m_header->tail).load(memory_order_relaxed);
+
+    uint64_t pos;
+    for (pos = tail; pos < head && (pos - tail) < max; pos++)
+    {
+        JournalRecord& record = m_records[pos % m_header->capacity];
+        if (atomic_ref(record.sequence).load(memory_order_acquire) != pos + 1)
+        {
+            // Torn write from a crash, nothing after this can be trusted
+            log(WARN, "read: Incomplete record at %" PRIu64 ", stopping", pos);
+            break;
+        }
+
+        Event& event = events.emplace_back();
+        event.flightId = record.flightId;
+        memcpy(&event.state, &record.state, sizeof(State));
+    }
+    return pos;
+}
+
+void Journal::consume(uint64_t upTo)
+{
+    atomic_ref(m_header->tail).store(upTo, memory_order_release);
+}
+
+void Journal::sync()
+{
+    if (m_mapping != nullptr)
+    {
+        msync(m_mapping, m_mappingSize, MS_ASYNC);
+    }
+}
+
+bool Journal::isEmpty() const
+{
+    return atomic_ref(m_header->head).load(memory_order_acquire) == atomic_ref(m_header->tail).load(memory_order_acquire);
+}
+
+uint64_t Journal::getPending() const
+{
+    return atomic_ref(m_header->head).load(memory_order_acquire) - atomic_ref(m_header->tail).load(memory_order_acquire);
+}
@@ -0,0 +1,74 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_JOURNAL_H
+#define BLACKBOX_JOURNAL_H
+
+#include <filesystem>
+#include <vector>
+
+#include "blackbox/logger.h"
+#include "blackbox/state.h"
+
+struct Event;
+
+struct JournalHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint64_t flightId;
+
+    // Only ever increase, records live at index % capacity
+    uint64_t head; // Next record to be written by the sim thread
+    uint64_t tail; // Next record to be ingested by the writer thread
+};
+
+struct JournalRecord
+{
+    // Written last, index + 1 once the record is complete
+    uint64_t sequence;
+    uint64_t flightId;
+    State state;
+};
+
+// A fixed size, memory mapped ring of State records for a single flight. The sim thread
+// appends with a memcpy, the writer thread moves the tail along once records are in the
+// database. Anything between the tail and head after a crash is replayed on the next start.
+class Journal : BlackBox::Logger
+{
+    std::filesystem::path m_path;
+
+    int m_fd = -1;
+    void* m_mapping = nullptr;
+    size_t m_mappingSize = 0;
+
+    JournalHeader* m_header = nullptr;
+    JournalRecord* m_records = nullptr;
+
+ public:
+    Journal();
+    ~Journal() override;
+
+    bool open(const std::filesystem::path& path, uint64_t flightId, uint32_t capacity);
+    void close();
+    void remove();
+
+    // Sim thread
+    bool append(const Event& event);
+    void setFlightId(uint64_t flightId) { m_header->flightId = flightId; }
+
+    // Writer thread
+    uint64_t read(std::vector<Event>& events, size_t max);
+    void consume(uint64_t upTo);
+    void sync();
+
+    [[nodiscard]] bool isEmpty() const;
+    [[nodiscard]] uint64_t getPending() const;
+    [[nodiscard]] uint64_t getFlightId() const { return m_header != nullptr ? m_header->flightId : 0; }
+    [[nodiscard]] const std::filesystem::path& getPath() const { return m_path; }
+};
+
+#endif //BLACKBOX_JOURNAL_H
@@ -5,6 +5,7 @@
 #include "plugin.h"
 #include "statuswindow.h"
 #include "writer.h"
+#include "blackbox/geo.h"
 
 #include <cfloat>
 #include <filesystem>
@@ -21,29 +22,6 @@ BlackBoxPlugin g_bbPlugin;
 constexpr float METRES_TO_FEET = 3.28084f;
 constexpr float MS_TO_KNOTS = 1.943844f;
 
-float degreesToRadians(float degrees)
-{
-    return degrees * M_PI / 180.0f;
-}
-
-double distance(Coordinate c1, Coordinate c2)
-{
-    constexpr float earthRadiusKm = 6371;
-
-    const auto dLat = degreesToRadians(c2.latitude-c1.latitude);
-    const auto dLon = degreesToRadians(c2.longitude-c1.longitude);
-
-    const float lat1 = degreesToRadians(c1.latitude);
-    const float lat2 = degreesToRadians(c2.latitude);
-
-    const auto a =
-        sinf(dLat/2.0f) * sinf(dLat/2.0f) +
-        sinf(dLon/2.0f) * sinf(dLon/2.0f) *
-        cosf(lat1) * cosf(lat2);
-    const auto c = 2.0f * atan2f(sqrtf(a), sqrtf(1-a));
-    return earthRadiusKm * c;
-}
-
 BlackBoxPlugin::BlackBoxPlugin() : Logger("BlackBox")
 {
     setLogPrinter(&m_logPrinter);
@@ -53,9 +31,12 @@ BlackBoxPlugin::BlackBoxPlugin() : Logger("BlackBox")
     reset();
 }
 
+BlackBoxPlugin::~BlackBoxPlugin() = default;
+
 void BlackBoxPlugin::reset()
 {
     m_state.flightPhase = FlightPhase::INIT;
+    m_phases.reset();
     m_fpm.reset();
 }
 
@@ -83,7 +64,7 @@ bool BlackBoxPlugin::start()
         return false;
     }
 
-    m_writer = make_unique<Writer>(this);
+    m_writer = make_unique<Writer>(this, databaseDir / "journal");
 
     m_aircraftICAODataRef = XPLMFindDataRef("sim/aircraft/view/acf_ICAO");
     m_flightIDDataRef = XPLMFindDataRef("sim/cockpit2/tcas/targets/flight_id");
@@ -105,6 +86,8 @@ bool BlackBoxPlugin::start()
     m_pausedDataRef = XPLMFindDataRef("sim/time/paused");
     m_replayDataRef = XPLMFindDataRef("sim/time/is_in_replay");
 
+    m_dataRefs.registerDataRefs(m_stats);
+
     XPLMCreateFlightLoop_t flightLoop;
     flightLoop.structSize = sizeof(flightLoop);
     flightLoop.callbackFunc = updateCallback;
@@ -133,6 +116,10 @@ bool BlackBoxPlugin::enable()
     reset();
 
     m_writer->start();
+    if (m_currentFlight.id != 0)
+    {
+        m_writer->startFlight(m_currentFlight.id);
+    }
 
     XPLMScheduleFlightLoop(m_updateFlightLoop, -1, true);
     return true;
@@ -148,6 +135,7 @@ bool BlackBoxPlugin::disable()
 
 bool BlackBoxPlugin::stop()
 {
+    m_dataRefs.unregisterDataRefs();
     return true;
 }
 
@@ -162,8 +150,15 @@ void BlackBoxPlugin::receiveMessage(XPLMPluginID from, int msg, void* param)
     {
         case XPLM_MSG_PLANE_CRASHED:
             log(DEBUG, "receiveMessage: User's plane crashed!");
-            m_state.eventType = EventType::CRASH;
-            // TODO: Write it to the DB!
+            if (m_currentFlight.id != 0)
+            {
+                m_state.flightPhase = FlightPhase::CRASHED;
+                m_phases.reset(FlightPhase::CRASHED);
+                m_state.eventType = EventType::CRASH;
+                updatePosition();
+                sendEvent(XPLMGetElapsedTime());
+                m_state.eventType = EventType::NONE;
+            }
             break;
 
         case XPLM_MSG_AIRPORT_LOADED:
@@ -179,12 +174,18 @@ void BlackBoxPlugin::receiveMessage(XPLMPluginID from, int msg, void* param)
 
 float BlackBoxPlugin::updateCallback(float elapsedMe, float elapsedSim, int counter, void* refcon)
 {
-    return static_cast<BlackBoxPlugin*>(refcon)->update(elapsedMe, elapsedSim, counter);
+    // Both of the times we're given are deltas, update() wants the time since the sim started
+    return static_cast<BlackBoxPlugin*>(refcon)->update(elapsedMe, XPLMGetElapsedTime(), counter);
 }
 
 void BlackBoxPlugin::sendEvent(float elapsedSim)
 {
-    m_state.timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    // From the sim's clock rather than the wall clock, so states are always in order and a
+    // headless run gets the same timestamps however fast it goes
+    double sinceStart = max(0.0, static_cast<double>(elapsedSim) - m_flightStartElapsed);
+    m_state.timestamp = m_currentFlight.startTime + static_cast<uint64_t>(sinceStart * 1000.0);
+
+    m_stats.phase.store(static_cast<int>(m_state.flightPhase), memory_order_relaxed);
 
     Event event;
     event.flightId = m_currentFlight.id;
@@ -239,6 +240,9 @@ std::string getString(const XPLMDataRef ref)
 
 void BlackBoxPlugin::createFlight()
 {
+    // X-Plane loads the next airport after a crash without disabling us, so start from scratch
+    reset();
+
     float latitude = XPLMGetDataf(m_latitudeDataRef);
     float longitude = XPLMGetDataf(m_longitudeDataRef);
     string id = findNearestAirport(latitude, longitude);
@@ -247,7 +251,9 @@ void BlackBoxPlugin::createFlight()
     m_currentFlight.icaoType = getString(m_aircraftICAODataRef);
     m_currentFlight.flightId = getString(m_flightIDDataRef);
     m_currentFlight.startTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    m_flightStartElapsed = XPLMGetElapsedTime();
     m_datastore.createFlight(m_currentFlight);
+    m_writer->startFlight(m_currentFlight.id);
 }
 
 void BlackBoxPlugin::updateFlight()
@@ -315,6 +321,8 @@ float BlackBoxPlugin::update(float elapsedMe, float elapsedSim, int counter)
         }
     }
 
+    m_writer->setIdle(m_state.paused || m_state.replay || m_state.flightPhase == FlightPhase::PARKED);
+
     if (m_state.paused || m_state.replay)
     {
         // Don't do anything while pause/replaying
@@ -344,173 +352,47 @@ float BlackBoxPlugin::update(float elapsedMe, float elapsedSim, int counter)
     m_state.pitch = pitch;
     m_state.fpm = fpm;
     m_state.fpmAverage = m_fpm.average();
+    m_state.parkingBrake = parkingBrake;
+    m_state.anyOnGround = anyOnGround;
+    m_state.allOnGround = allOnGround;
+    m_stats.fpmAverage.store(m_state.fpmAverage, memory_order_relaxed);
 
-    if (m_state.flightPhase == FlightPhase::INIT)
-    {
-        // Work out where we started...
-        if (allOnGround)
-        {
-            setMessage("Starting in PARKED phase");
-            m_state.flightPhase = FlightPhase::PARKED;
-        }
-        else
-        {
-            setMessage("Starting in FLIGHT phase");
-            m_state.flightPhase = FlightPhase::FLIGHT;
-        }
+    PhaseStep step = m_phases.update(PhaseInput::fromState(m_state));
+    m_state.flightPhase = step.phase;
 
+    bool changes = step.phaseChanged || step.inputChanged;
+    bool updatedPosition = false;
+
+    if (step.event == EventType::LANDING)
+    {
+        // TODO: This should be asynchronous
         updatePosition();
-        sendEvent(elapsedSim);
+        updatedPosition = true;
 
-        return -1;
-    }
+        string airport = findNearestAirport(m_state.position.latitude, m_state.position.longitude);
+        m_currentFlight.destination = airport;
+        m_datastore.updateFlight(m_currentFlight);
 
-    bool changes = false;
-    bool parkingBrakeChanged = false;
-    if (parkingBrake != m_state.parkingBrake)
-    {
-        parkingBrakeChanged = true;
-        changes = true;
+        setMessage(
+            "%s: airport=%s, FPM=%0.2f (average=%0.2f), G-Force=%0.2f, pitch=%0.2f",
+            step.message,
+            airport.c_str(),
+            fpm,
+            m_state.fpmAverage,
+            gForce,
+            pitch);
     }
-
-    bool anyOnGroundChanged = false;
-    if (anyOnGround != m_state.anyOnGround)
+    else if (step.reportForces)
     {
-        anyOnGroundChanged = true;
-        changes = true;
+        setMessage("%s FPM=%0.2f, G-Force=%0.2f", step.message, fpm, gForce);
     }
-
-    bool allOnGroundChanged = false;
-    if (allOnGround != m_state.allOnGround)
+    else if (step.message != nullptr)
     {
-        allOnGroundChanged = true;
-        changes = true;
+        setMessage("%s", step.message);
     }
-
-    m_state.parkingBrake = parkingBrake;
-    m_state.anyOnGround = anyOnGround;
-    m_state.allOnGround = allOnGround;
-
-    bool descending = m_state.fpmAverage < -100.0f;
-    bool climbing = m_state.fpmAverage > 500.0f;
-    bool updatedPosition = false;
-
-    switch (m_state.flightPhase)
+    if (step.event != EventType::NONE)
     {
-        case FlightPhase::PARKED:
-            if (!m_state.parkingBrake)
-            {
-                setMessage("PARKED: Parking brake released, taxiing");
-                m_state.flightPhase = FlightPhase::TAXI;
-                changes = true;
-            }
-            else if (groundSpeed > 1.0f)
-            {
-                // The X-Plane AI likes to brake with the parking brake, so don't log this!
-                //setMessage("PARKED: We're moving when parked?", groundSpeed);
-            }
-            if (!allOnGround)
-            {
-                setMessage("PARKED: Wheels aren't all on ground??");
-            }
-            break;
-
-        case FlightPhase::TAXI:
-            if (parkingBrakeChanged && m_state.parkingBrake)
-            {
-                setMessage("TAXI: Parking brake set, parked");
-                m_state.flightPhase = FlightPhase::PARKED;
-                changes = true;
-            }
-            else if (groundSpeed > 40.0 || (groundSpeed > 20 && !allOnGround))
-            {
-                setMessage("TAXI: Looks like we're taking off!");
-                m_state.flightPhase = FlightPhase::TAKE_OFF;
-                changes = true;
-            }
-            break;
-
-        case FlightPhase::TAKE_OFF:
-            if (allOnGroundChanged && !allOnGround)
-            {
-                setMessage("TAKE_OFF: Rotating");
-            }
-            else if (!anyOnGround)
-            {
-                setMessage("TAKE_OFF: We're up!");
-                m_state.flightPhase = FlightPhase::FLIGHT;
-                m_state.eventType = EventType::TAKE_OFF;
-                changes = true;
-            }
-            break;
-
-        case FlightPhase::FLIGHT:
-            if (descending && agl < 1000.0f)
-            {
-                setMessage("DESCENT: Approaching ground");
-                m_state.flightPhase = FlightPhase::APPROACH;
-                changes = true;
-                // TODO: Are we stable??
-            }
-            break;
-
-        case FlightPhase::APPROACH:
-            if (anyOnGroundChanged && anyOnGround)
-            {
-                // TODO: This should be asynchronous
-                updatePosition();
-                updatedPosition = true;
-
-                string airport = findNearestAirport(m_state.position.latitude, m_state.position.longitude);
-                m_currentFlight.destination = airport;
-                m_datastore.updateFlight(m_currentFlight);
-
-                setMessage(
-                    "APPROACH: Landing Started: airport=%s, FPM=%0.2f (average=%0.2f), G-Force=%0.2f, pitch=%0.2f",
-                    airport.c_str(),
-                    fpm,
-                    m_fpm.average(),
-                    gForce,
-                    pitch);
-                m_state.flightPhase = FlightPhase::LANDING;
-                m_state.eventType = EventType::LANDING;
-
-                changes = true;
-            }
-            else if (climbing && agl > 1000.0f)
-            {
-                setMessage("APPROACH: Go around??");
-                m_state.flightPhase = FlightPhase::FLIGHT;
-                changes = true;
-            }
-            break;
-
-        case FlightPhase::LANDING:
-            if (anyOnGroundChanged && !anyOnGround)
-            {
-                setMessage("LANDING: Bounce!");
-            }
-            else if (!anyOnGround && agl > 100.0f)
-            {
-                setMessage("LANDING: Go around?");
-                m_state.flightPhase = FlightPhase::FLIGHT;
-                changes = true;
-            }
-            else if (allOnGroundChanged && allOnGround)
-            {
-                setMessage("LANDING: Landing finished? FPM=%0.2f, G-Force=%0.2f", fpm, gForce);
-            }
-            if (m_state.fpmAverage < 10 && allOnGround && groundSpeed < 40)
-            {
-                setMessage("LANDING: Slowed down to taxiing");
-                m_state.flightPhase = FlightPhase::TAXI;
-                changes = true;
-            }
-            break;
-
-        default:
-            setMessage("Warning: Unhandled flight phase: %d", m_state.flightPhase);
-            break;
+        m_state.eventType = step.event;
     }
 
     float diff = elapsedSim - m_lastSendTime;
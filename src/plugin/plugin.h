@@ -18,7 +18,9 @@
 
 #include "blackbox/datastore.h"
 #include "blackbox/logger.h"
+#include "blackbox/phases.h"
 #include "blackbox/state.h"
+#include "datarefs.h"
 
 class Writer;
 
@@ -86,7 +88,11 @@ class BlackBoxPlugin : public BlackBox::Logger
     Flight m_currentFlight;
 
     std::unique_ptr<Writer> m_writer;
+    RecorderStats m_stats;
+    RecorderDataRefs m_dataRefs;
     float m_lastSendTime = 0;
+    // Sim time when the flight started, states are timestamped from this
+    float m_flightStartElapsed = 0;
     UFC::Coordinate m_lastPosition;
 
     XPLMDataRef m_aircraftICAODataRef = nullptr;
@@ -112,6 +118,7 @@ class BlackBoxPlugin : public BlackBox::Logger
     XPLMFlightLoopID m_updateFlightLoop = nullptr;
 
     State m_state;
+    PhaseMachine m_phases;
 
     DataSet m_fpm;
 
@@ -119,7 +126,7 @@ class BlackBoxPlugin : public BlackBox::Logger
     XPLMMenuID m_menuId = nullptr;
     int m_showWindowMenu = 0;
 
-    std::unique_ptr<StatusWindow> m_statusWindow = nullptr;
+    std::unique_ptr<StatusWindow> m_statusWindow;
 
     static float updateCallback(float elapsedMe, float elapsedSim, int counter, void * refcon);
 
@@ -141,7 +148,7 @@ class BlackBoxPlugin : public BlackBox::Logger
 
  public:
     BlackBoxPlugin();
-    ~BlackBoxPlugin() override = default;
+    ~BlackBoxPlugin() override;
 
     void reset();
 
@@ -155,6 +162,8 @@ class BlackBoxPlugin : public BlackBox::Logger
     void updateFlight();
 
     DataStore& getDataStore() { return m_datastore; }
+    [[nodiscard]] const Writer* getWriter() const { return m_writer.get(); }
+    RecorderStats& getStats() { return m_stats; }
     [[nodiscard]] FlightPhase getFlightPhase() const { return m_state.flightPhase; }
     [[nodiscard]] const State& getState() const { return m_state; }
 
@@ -3,6 +3,9 @@
 //
 
 #include "statuswindow.h"
+#include "writer.h"
+
+#include <cinttypes>
 
 #include <XPLMGraphics.h>
 
@@ -109,5 +112,18 @@ void StatusWindow::draw(XPLMWindowID in_window_id) const
 
     snprintf(buf, 1024, "Last message: %s", m_plugin->getMessage().c_str());
     XPLMDrawString(col_white, l + 10, t - ((char_height * 2) + 10), buf, nullptr, xplmFont_Proportional);
+
+    const Writer* writer = m_plugin->getWriter();
+    if (writer != nullptr && writer->isDegraded())
+    {
+        float col_red[] = {1.0, 0.2, 0.2};
+        const char* reason = "Slow disk";
+        if (writer->getLastError() != SQLITE_OK)
+        {
+            reason = sqlite3_errstr(writer->getLastError());
+        }
+        snprintf(buf, 1024, "Recorder degraded: %s, dropped: %" PRIu64, reason, writer->getDroppedEvents());
+        XPLMDrawString(col_red, l + 10, t - ((char_height * 3) + 15), buf, nullptr, xplmFont_Proportional);
+    }
 }
 
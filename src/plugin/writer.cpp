@@ -3,14 +3,49 @@
 //
 
 #include "writer.h"
+#include "journal.h"
 #include "plugin.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <tuple>
+
 using namespace std;
 using namespace UFC;
 using namespace BlackBox;
 
-Writer::Writer(BlackBoxPlugin* plugin) : Logger("Writer"), m_plugin(plugin)
+// Enough for several hours of samples if the writer gets stuck
+constexpr uint32_t JOURNAL_CAPACITY = 65536;
+
+// The journal doesn't signal us, so poll it
+constexpr auto INGEST_INTERVAL = chrono::milliseconds(250);
+constexpr size_t MAX_INGEST_BATCH = 4096;
+
+// Upper limit on the fallback queue, the oldest samples are dropped after this
+constexpr size_t MAX_QUEUED_EVENTS = 10000;
+
+// Commits taking longer than this mean the disk is struggling
+constexpr auto SLOW_COMMIT_TIME = chrono::milliseconds(500);
+
+constexpr auto MIN_RETRY_DELAY = chrono::milliseconds(250);
+constexpr auto MAX_RETRY_DELAY = chrono::milliseconds(30000);
+
+// Checkpoint regardless of what the sim is doing once the WAL gets this big
+constexpr uint64_t WAL_SIZE_BUDGET = 8 * 1024 * 1024;
+
+// How often we'll checkpoint while idle
+constexpr auto IDLE_CHECKPOINT_INTERVAL = chrono::seconds(10);
+
+Writer::Writer(BlackBoxPlugin* plugin, filesystem::path journalDir) :
+    Logger("Writer"),
+    m_plugin(plugin),
+    m_journalDir(std::move(journalDir))
+{
+}
+
+Writer::~Writer()
 {
+    stop();
 }
 
 void Writer::close()
@@ -26,6 +61,8 @@ void Writer::start()
         return;
     }
 
+    replayJournals();
+
     m_running = true;
     m_writerThread = new thread(&Writer::main, this);
 }
@@ -48,34 +85,443 @@ void Writer::stop()
     log(DEBUG, "stop: Waiting for writer thread to finish...");
     m_writerThread->join();
     m_writerThread = nullptr;
+
+    // Anything that didn't make it to the database will be replayed next time
+    scoped_lock lock(m_mutex);
+    if (!m_queue.empty() || !m_priorityQueue.empty())
+    {
+        log(WARN, "stop: Unable to write %zu queued events", m_queue.size() + m_priorityQueue.size());
+        m_queue.clear();
+        m_priorityQueue.clear();
+    }
+    if (m_journal != nullptr)
+    {
+        m_retiredJournals.push_back(std::move(m_journal));
+    }
+    if (m_spareJournal != nullptr)
+    {
+        m_retiredJournals.push_back(std::move(m_spareJournal));
+    }
+    for (auto& journal : m_retiredJournals)
+    {
+        if (journal->isEmpty())
+        {
+            journal->remove();
+        }
+    }
+    m_retiredJournals.clear();
+}
+
+void Writer::startFlight(uint64_t flightId)
+{
+    // Called from the flight loop, the writer thread has already done the slow part
+    scoped_lock lock(m_mutex);
+    if (m_journal != nullptr)
+    {
+        m_retiredJournals.push_back(std::move(m_journal));
+    }
+    m_journalFlightId = flightId;
+    takeSpareJournal(flightId);
+    m_queueSignal.notify_one();
 }
 
 void Writer::write(const Event &event)
 {
+    if (event.state.eventType != EventType::NONE)
+    {
+        // These are rare, and we want them on disk before anything else
+        scoped_lock lock(m_mutex);
+        m_priorityQueue.push_back(event);
+        m_queueSignal.notify_one();
+        return;
+    }
+
+    // This is called from the flight loop, so avoid locks and system calls
+    if (m_journal != nullptr && m_journal->append(event))
+    {
+        return;
+    }
+
     scoped_lock lock(m_mutex);
+    if (m_journal == nullptr && m_journalFlightId == event.flightId)
+    {
+        // There wasn't a spare when the flight started, there may be now
+        takeSpareJournal(event.flightId);
+        if (m_journal != nullptr && m_journal->append(event))
+        {
+            return;
+        }
+    }
+
     m_queue.push_back(event);
+    trimQueue();
     m_queueSignal.notify_one();
 }
 
+void Writer::takeSpareJournal(uint64_t flightId)
+{
+    if (m_spareJournal != nullptr)
+    {
+        m_spareJournal->setFlightId(flightId);
+        m_journal = std::move(m_spareJournal);
+    }
+}
+
+void Writer::trimQueue()
+{
+    if (m_queue.size() > MAX_QUEUED_EVENTS)
+    {
+        size_t dropped = m_queue.size() - MAX_QUEUED_EVENTS;
+        m_queue.erase(m_queue.begin(), m_queue.begin() + static_cast<ptrdiff_t>(dropped));
+        m_droppedEvents += dropped;
+    }
+}
+
 void Writer::main()
 {
+    prepareJournal();
+
+    // Only does anything the first time after upgrading
+    m_plugin->getDataStore().backfillSummaries();
+
     while (m_running)
     {
-        vector<Event> events;
-
         {
             unique_lock lock(m_mutex);
-            m_queueSignal.wait(lock);
-            events = m_queue;
-            m_queue.clear();
+            if (m_lastError != SQLITE_OK && chrono::steady_clock::now() < m_retryTime)
+            {
+                // Backing off, whatever's queued will still be there afterwards
+                m_queueSignal.wait_until(lock, m_retryTime, [this] { return !m_running; });
+            }
+            else
+            {
+                m_queueSignal.wait_for(lock, INGEST_INTERVAL, [this]
+                {
+                    return !m_queue.empty() || !m_priorityQueue.empty() || !m_running;
+                });
+            }
         }
 
-        m_plugin->getDataStore().startTransaction();
-        for (const Event& event : events)
+        ingest();
+        prepareJournal();
+        checkpoint();
+        publishStats();
+    }
+
+    // Pick up anything written while we were stopping
+    ingest();
+}
+
+void Writer::prepareJournal()
+{
+    {
+        scoped_lock lock(m_mutex);
+        if (m_spareJournal != nullptr)
         {
-            m_plugin->getDataStore().writeState(event.flightId, event.state);
+            return;
         }
+    }
+
+    auto now = chrono::steady_clock::now();
+    if (now < m_spareRetryTime)
+    {
+        return;
+    }
+
+    // Creating and touching every page takes a while, so do it before it's needed. The flight
+    // is filled in when it's taken.
+    auto journal = make_unique<Journal>();
+    auto name = to_string(chrono::system_clock::now().time_since_epoch().count());
+    filesystem::path path = m_journalDir / ("journal-" + name + ".journal");
+    if (!journal->open(path, 0, JOURNAL_CAPACITY))
+    {
+        log(ERROR, "prepareJournal: Unable to create journal, flights will fall back to the queue");
+        m_spareRetryTime = now + MAX_RETRY_DELAY;
+        return;
+    }
+
+    scoped_lock lock(m_mutex);
+    m_spareJournal = std::move(journal);
+}
+
+void Writer::ingest()
+{
+    if (m_lastError != SQLITE_OK && chrono::steady_clock::now() < m_retryTime)
+    {
+        return;
+    }
+
+    vector<Event> priority;
+    vector<Event> queued;
+    vector<Journal*> journals;
+    {
+        // Take the priority events first, anything the sim thread wrote before them is then
+        // either on the queue or visible in the journal
+        scoped_lock lock(m_mutex);
+        priority = std::move(m_priorityQueue);
+        m_priorityQueue.clear();
+        queued = std::move(m_queue);
+        m_queue.clear();
+
+        for (auto& journal : m_retiredJournals)
+        {
+            journals.push_back(journal.get());
+        }
+        if (m_journal != nullptr)
+        {
+            journals.push_back(m_journal.get());
+        }
+    }
+
+    // Priority events and the queue (which overflows from a full journal) are newer than the
+    // journals' backlog. They mustn't get ahead of it, so drain the journals completely and
+    // commit the lot together, in order.
+    bool drain = !priority.empty() || !queued.empty();
+    size_t max = drain ? JOURNAL_CAPACITY : MAX_INGEST_BATCH;
+
+    vector<Event> events = queued;
+    vector<uint64_t> consumed;
+    for (Journal* journal : journals)
+    {
+        consumed.push_back(journal->read(events, max));
+    }
+
+    if (drain)
+    {
+        log(DEBUG, "ingest: Writing %zu priority events with %zu samples", priority.size(), events.size());
+        events.insert(events.end(), priority.begin(), priority.end());
+        stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+        {
+            return tie(a.flightId, a.state.timestamp) < tie(b.flightId, b.state.timestamp);
+        });
+    }
+
+    if (!events.empty() && !writeEvents(events, !priority.empty()))
+    {
+        // Journal records stay where they are, everything else goes back on its queue
+        scoped_lock lock(m_mutex);
+        m_priorityQueue.insert(m_priorityQueue.begin(), priority.begin(), priority.end());
+        m_queue.insert(m_queue.begin(), queued.begin(), queued.end());
+        trimQueue();
+        return;
+    }
+
+    for (size_t i = 0; i < journals.size(); i++)
+    {
+        journals[i]->consume(consumed[i]);
+        journals[i]->sync();
+    }
+
+    scoped_lock lock(m_mutex);
+    erase_if(m_retiredJournals, [](const unique_ptr<Journal>& journal)
+    {
+        if (journal->isEmpty())
+        {
+            journal->remove();
+            return true;
+        }
+        return false;
+    });
+}
+
+bool Writer::writeEvents(const vector<Event>& events, bool durable)
+{
+    DataStore& dataStore = m_plugin->getDataStore();
+
+    auto startTime = chrono::steady_clock::now();
+    if (durable)
+    {
+        dataStore.setDurable(true);
+    }
+
+    // Only kept if the commit succeeds
+    map<uint64_t, FlightSummary> summaries;
+
+    int res = dataStore.startTransaction();
+    for (auto it = events.begin(); it != events.end() && res == SQLITE_OK; ++it)
+    {
+        // Before writing the state, a flight without a summary is summarised from what's stored
+        auto summaryIt = summaries.find(it->flightId);
+        if (summaryIt == summaries.end())
+        {
+            summaryIt = summaries.emplace(it->flightId, getSummary(it->flightId)).first;
+        }
+        summaryIt->second.add(it->state);
+
+        res = dataStore.writeState(it->flightId, it->state);
+    }
+    for (auto it = summaries.begin(); it != summaries.end() && res == SQLITE_OK; ++it)
+    {
+        res = dataStore.writeSummary(it->first, it->second);
+    }
+    if (res == SQLITE_OK)
+    {
         m_plugin->updateFlight();
-        m_plugin->getDataStore().commitTransaction();
+        res = dataStore.commitTransaction();
+    }
+
+    if (res != SQLITE_OK)
+    {
+        dataStore.rollbackTransaction();
+    }
+    if (durable)
+    {
+        dataStore.setDurable(false);
+    }
+    if (res != SQLITE_OK)
+    {
+        backOff(res);
+        return false;
+    }
+
+    auto duration = chrono::steady_clock::now() - startTime;
+    m_plugin->getStats().commitLatency = chrono::duration<float, milli>(duration).count();
+    m_samplesWritten += events.size();
+
+    bool slow = duration > SLOW_COMMIT_TIME;
+    if (slow)
+    {
+        log(
+            WARN,
+            "writeEvents: Slow commit: %zu events took %lldms",
+            events.size(),
+            static_cast<long long>(chrono::duration_cast<chrono::milliseconds>(duration).count()));
+    }
+    else if (m_degraded)
+    {
+        log(INFO, "writeEvents: Recovered");
+    }
+
+    for (const auto& [flightId, summary] : summaries)
+    {
+        m_summaries[flightId] = summary;
+    }
+
+    m_degraded = slow;
+    m_lastError = SQLITE_OK;
+    m_retryDelay = chrono::milliseconds(0);
+    return true;
+}
+
+FlightSummary Writer::getSummary(uint64_t flightId)
+{
+    auto it = m_summaries.find(flightId);
+    if (it != m_summaries.end())
+    {
+        return it->second;
+    }
+
+    DataStore& dataStore = m_plugin->getDataStore();
+    FlightSummary summary;
+    if (!dataStore.fetchSummary(flightId, summary))
+    {
+        // A new flight, or one that hasn't been backfilled yet
+        summary = dataStore.summariseFlight(flightId);
+    }
+    return summary;
+}
+
+void Writer::backOff(int error)
+{
+    m_retryDelay = clamp(m_retryDelay * 2, MIN_RETRY_DELAY, MAX_RETRY_DELAY);
+    m_retryTime = chrono::steady_clock::now() + m_retryDelay;
+    m_lastError = error;
+    m_degraded = true;
+
+    log(WARN, "backOff: Write failed: %s, retrying in %lldms", sqlite3_errstr(error), static_cast<long long>(m_retryDelay.count()));
+}
+
+void Writer::replayJournals()
+{
+    error_code ec;
+    filesystem::create_directories(m_journalDir, ec);
+
+    for (const auto& entry : filesystem::directory_iterator(m_journalDir, ec))
+    {
+        if (entry.path().extension() != ".journal")
+        {
+            continue;
+        }
+
+        Journal journal;
+        if (!journal.open(entry.path(), 0, JOURNAL_CAPACITY))
+        {
+            continue;
+        }
+
+        vector<Event> events;
+        uint64_t upTo = journal.read(events, JOURNAL_CAPACITY);
+
+        // We may have crashed between committing and moving the tail along. Priority events
+        // don't go through the journal, so we can't just look at the latest timestamp.
+        if (!events.empty())
+        {
+            auto existing = m_plugin->getDataStore().fetchTimestamps(journal.getFlightId(), events.front().state.timestamp);
+            erase_if(events, [&existing](const Event& event)
+            {
+                return binary_search(existing.begin(), existing.end(), event.state.timestamp);
+            });
+        }
+
+        log(INFO, "replayJournals: Replaying %zu events from %s", events.size(), entry.path().c_str());
+        if (!events.empty() && !writeEvents(events))
+        {
+            // Leave it for next time
+            continue;
+        }
+
+        journal.consume(upTo);
+        journal.remove();
+    }
+}
+
+void Writer::checkpoint()
+{
+    DataStore& dataStore = m_plugin->getDataStore();
+    uint64_t walSize = dataStore.getPendingWALSize();
+    if (walSize == 0)
+    {
+        return;
+    }
+
+    auto now = chrono::steady_clock::now();
+    bool overBudget = walSize > WAL_SIZE_BUDGET;
+    bool idle = m_idle && (now - m_lastCheckpoint) > IDLE_CHECKPOINT_INTERVAL;
+    if (overBudget || idle)
+    {
+        log(DEBUG, "checkpoint: Checkpointing %" PRIu64 "KB of WAL (idle=%d)", walSize / 1024, m_idle.load());
+        dataStore.checkpoint();
+        m_lastCheckpoint = now;
+    }
+}
+
+void Writer::publishStats()
+{
+    RecorderStats& stats = m_plugin->getStats();
+
+    uint64_t depth;
+    {
+        scoped_lock lock(m_mutex);
+        depth = m_queue.size() + m_priorityQueue.size();
+        for (const auto& journal : m_retiredJournals)
+        {
+            depth += journal->getPending();
+        }
+        if (m_journal != nullptr)
+        {
+            depth += m_journal->getPending();
+        }
+    }
+    stats.queueDepth = static_cast<int>(depth);
+    stats.droppedSamples = static_cast<int>(m_droppedEvents.load());
+    stats.bytesWritten = static_cast<double>(m_plugin->getDataStore().getBytesWritten());
+
+    auto now = chrono::steady_clock::now();
+    auto elapsed = chrono::duration<float>(now - m_statsTime).count();
+    if (elapsed >= 1.0f)
+    {
+        stats.samplesPerSecond = static_cast<float>(m_samplesWritten) / elapsed;
+        m_samplesWritten = 0;
+        m_statsTime = now;
     }
 }
@@ -5,12 +5,17 @@
 #ifndef BLACKBOX_SENDER_H
 #define BLACKBOX_SENDER_H
 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
 #include <thread>
 
 #include "blackbox/logger.h"
 #include "blackbox/datastore.h"
 
 class BlackBoxPlugin;
+class Journal;
 
 struct Event
 {
@@ -22,24 +27,73 @@ class Writer : BlackBox::Logger
 {
     BlackBoxPlugin* m_plugin = nullptr;
 
+    std::filesystem::path m_journalDir;
+
+    // Only changed by the sim thread, and under m_mutex
+    std::unique_ptr<Journal> m_journal;
+    uint64_t m_journalFlightId = 0;
+    // Created ahead of time by the writer thread, so starting a flight is just a swap
+    std::unique_ptr<Journal> m_spareJournal;
+    std::chrono::steady_clock::time_point m_spareRetryTime;
+    // Journals from previous flights still being ingested
+    std::vector<std::unique_ptr<Journal>> m_retiredJournals;
+
     std::thread* m_writerThread = nullptr;
+    // Only used when there's no journal or it's full
     std::vector<Event> m_queue;
+    // Take offs, landings and crashes, these are committed straight away along with the samples before them
+    std::vector<Event> m_priorityQueue;
     std::mutex m_mutex;
     std::condition_variable m_queueSignal;
 
     bool m_running = false;
 
+    // Set when writes are failing or commits are slow
+    std::atomic<bool> m_degraded = false;
+    std::atomic<int> m_lastError = SQLITE_OK;
+    std::atomic<uint64_t> m_droppedEvents = 0;
+    std::chrono::milliseconds m_retryDelay {0};
+    std::chrono::steady_clock::time_point m_retryTime;
+
+    // Set by the sim thread when nothing interesting is happening (Paused, parked etc)
+    std::atomic<bool> m_idle = false;
+    std::chrono::steady_clock::time_point m_lastCheckpoint;
+
+    // Only used by the writer thread
+    std::map<uint64_t, FlightSummary> m_summaries;
+
+    uint64_t m_samplesWritten = 0;
+    std::chrono::steady_clock::time_point m_statsTime;
+
     void main();
+    void ingest();
+    void prepareJournal();
+    bool writeEvents(const std::vector<Event>& events, bool durable = false);
+    FlightSummary getSummary(uint64_t flightId);
+    void backOff(int error);
+    void trimQueue();
+    void takeSpareJournal(uint64_t flightId);
+    void replayJournals();
+    void checkpoint();
+    void publishStats();
 
  public:
-    explicit Writer(BlackBoxPlugin* plugin);
+    Writer(BlackBoxPlugin* plugin, std::filesystem::path journalDir);
+    ~Writer() override;
 
     void close();
 
     void start();
     void stop();
 
+    void startFlight(uint64_t flightId);
     void write(const Event& event);
+
+    void setIdle(bool idle) { m_idle = idle; }
+
+    [[nodiscard]] bool isDegraded() const { return m_degraded; }
+    [[nodiscard]] int getLastError() const { return m_lastError; }
+    [[nodiscard]] uint64_t getDroppedEvents() const { return m_droppedEvents; }
 };
 
 #endif //BLACKBOX_SENDER_H
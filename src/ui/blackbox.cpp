@@ -5,12 +5,16 @@
 #include "blackbox.h"
 #include "mainwindow.h"
 
+#include <cinttypes>
+
 #include <QCommandLineParser>
 #include <QSettings>
 #include <QFileDialog>
 
 using namespace std;
 
+static const char* DEFAULT_TILE_URL = "https://tile.openstreetmap.org/${z}/${x}/${y}.png";
+
 BlackBoxUI::BlackBoxUI(int argc, char** argv) : m_app(argc, argv)
 {
     QApplication::setApplicationName("BlackBox Flight Tracker");
@@ -20,12 +24,27 @@ BlackBoxUI::BlackBoxUI(int argc, char** argv) : m_app(argc, argv)
     QCommandLineParser parser;
     parser.addHelpOption();
     parser.addVersionOption();
+    QCommandLineOption reanalyseOption("reanalyse", "Re-run phase and event detection over every flight, then exit");
+    parser.addOption(reanalyseOption);
+    QCommandLineOption threadsOption("threads", "Number of threads to re-analyse with (default: one per core)", "threads", "0");
+    parser.addOption(threadsOption);
+    QCommandLineOption tileUrlOption("tile-url", "Where to download map tiles from, with ${z}, ${x} and ${y} for the tile", "url");
+    parser.addOption(tileUrlOption);
     parser.process(m_app);
 
+    m_reanalyse = parser.isSet(reanalyseOption);
+    m_reanalyseThreads = parser.value(threadsOption).toUInt();
+
 
     QSettings settings("geekprojects", "BlackBox");
     printf("Settings file: %s\n", settings.fileName().toStdString().c_str());
 
+    m_tileUrl = settings.value("TileUrl", DEFAULT_TILE_URL).toString();
+    if (parser.isSet(tileUrlOption))
+    {
+        m_tileUrl = parser.value(tileUrlOption);
+    }
+
     string xplaneDir;
     auto xplaneDirValue = settings.value("XPlaneDir");
     if (xplaneDirValue.isValid())
@@ -74,45 +93,141 @@ BlackBoxUI::BlackBoxUI(int argc, char** argv) : m_app(argc, argv)
 
     m_dataStore.init(databaseFile.string());
 
+    if (m_reanalyse)
+    {
+        // In case the plugin hasn't been run since upgrading
+        m_dataStore.backfillSummaries();
+        return;
+    }
+
+    m_databaseWatcher = std::make_unique<DatabaseWatcher>(m_dataStore);
+
+    // Finish off anything that was deleted last time
+    m_purger = std::make_unique<Purger>(m_dataStore.getPath());
+    m_purger->wake();
+
     m_mainWindow = new MainWindow(this);
     m_mainWindow->init();
+
+    backfillSummaries();
+}
+
+BlackBoxUI::~BlackBoxUI()
+{
+    if (m_backfillThread.joinable())
+    {
+        m_backfillThread.join();
+    }
+}
+
+void BlackBoxUI::backfillSummaries()
+{
+    // In case the plugin hasn't been run since upgrading. It reads every state of every flight
+    // without a summary, so it's done on its own connection and the flights are shown without
+    // their summaries until it's finished.
+    m_backfillThread = thread([this, dbPath = m_dataStore.getPath()]()
+    {
+        DataStore dataStore;
+        if (!dataStore.init(dbPath))
+        {
+            return;
+        }
+
+        size_t summarised = 0;
+        dataStore.backfillSummaries(&summarised);
+        if (summarised == 0)
+        {
+            return;
+        }
+
+        auto flights = dataStore.fetchFlights();
+        QMetaObject::invokeMethod(&m_app, [this, flights = std::move(flights)]() mutable
+        {
+            reloadFlights(std::move(flights));
+        });
+    });
 }
 
 int BlackBoxUI::run()
 {
+    if (m_reanalyse)
+    {
+        ReanalyseResult result = reanalyse(m_reanalyseThreads, [](size_t done, size_t total)
+        {
+            printf("\rRe-analysing: %zu/%zu flights", done, total);
+            fflush(stdout);
+        });
+        printf(
+            "\nRe-analysed %zu flights (%zu states, %zu changed) in %0.2f seconds: %0.1f flights/second\n",
+            result.flights,
+            result.states,
+            result.changed,
+            result.seconds,
+            result.getFlightsPerSecond());
+        return result.success ? 0 : 1;
+    }
+
     m_mainWindow->show();
     return m_app.exec();
 }
 
+ReanalyseResult BlackBoxUI::reanalyse(unsigned int threads, const std::function<void(size_t done, size_t total)>& progress)
+{
+    Reanalyser reanalyser(m_dataStore.getPath(), PhaseThresholds(), threads);
+    return reanalyser.run(progress);
+}
+
 void BlackBoxUI::updateFlights()
 {
-    const auto flights = m_dataStore.fetchFlights();
-    const uint64_t currentFlightId = m_currentFlight.id;
+    uint64_t fromId = m_flights->getLastId();
+    m_flights = m_flights->merge(fromId, m_dataStore.fetchFlights(fromId));
+    flightsChanged(false);
+}
 
-    m_flights.clear();
-    uint64_t lastFlightId = 0;
-    for (auto flight : flights)
+void BlackBoxUI::reloadFlights(vector<Flight> flights)
+{
+    m_flights = make_shared<FlightCatalogue>()->merge(0, std::move(flights));
+    flightsChanged(true);
+}
+
+void BlackBoxUI::flightsChanged(bool reload)
+{
+    const Flight* current = m_flights->find(m_currentFlight.id);
+    if (current != nullptr)
     {
-        m_flights.emplace(flight.id, flight);
-        if (flight.id > lastFlightId)
-        {
-            lastFlightId = flight.id;
-        }
+        m_currentFlight = *current;
     }
+    else if (!m_flights->empty())
+    {
+        m_currentFlight = *m_flights->find(m_flights->getLastId());
+        printf("Updating current flight: %" PRIu64 "\n", m_currentFlight.id);
+    }
+    else
+    {
+        m_currentFlight = Flight();
+    }
+    m_mainWindow->updateFlights(reload);
+}
 
-    const auto it = m_flights.find(currentFlightId);
-    if (it == m_flights.end())
+void BlackBoxUI::deleteFlight(uint64_t flightId)
+{
+    m_dataStore.deleteFlight(flightId);
+    m_purger->wake();
+
+    m_flights = m_flights->remove(flightId);
+    if (m_currentFlight.id == flightId)
     {
-        if (!m_flights.empty())
-        {
-            m_currentFlight = m_flights.at(lastFlightId);
-            printf("Updating current flight: %lld\n", m_currentFlight.id);
-        }
-        else
-        {
-            m_currentFlight.id = 0;
-        }
-        m_mainWindow->updateFlights();
+        m_currentFlight.id = 0;
+    }
+    updateFlights();
+}
+
+void BlackBoxUI::setCurrentFlightId(uint64_t flightId)
+{
+    const Flight* flight = m_flights->find(flightId);
+    if (flight != nullptr)
+    {
+        m_currentFlight = *flight;
     }
 }
 
@@ -5,9 +5,16 @@
 #ifndef BLACKBOX_BLACKBOX_H
 #define BLACKBOX_BLACKBOX_H
 
+#include <memory>
+#include <thread>
+
 #include <QApplication>
 
 #include "blackbox/datastore.h"
+#include "blackbox/purger.h"
+#include "blackbox/reanalyser.h"
+#include "databasewatcher.h"
+#include "flightcatalogue.h"
 
 class MainWindow;
 
@@ -17,27 +24,55 @@ class BlackBoxUI
     MainWindow* m_mainWindow = nullptr;
 
     DataStore m_dataStore;
+    std::unique_ptr<DatabaseWatcher> m_databaseWatcher;
+    std::unique_ptr<Purger> m_purger;
+    std::thread m_backfillThread;
 
     State m_latestState;
 
-    std::map<uint64_t, Flight> m_flights;
+    std::shared_ptr<const FlightCatalogue> m_flights = std::make_shared<FlightCatalogue>();
     Flight m_currentFlight;
 
+    // Run from the command line without showing any UI
+    bool m_reanalyse = false;
+    unsigned int m_reanalyseThreads = 0;
+
+    // Where map tiles the store doesn't have come from
+    QString m_tileUrl;
+
+    void backfillSummaries();
+    void flightsChanged(bool reload);
+
  public:
     BlackBoxUI(int argc, char** argv);
-    ~BlackBoxUI() = default;
+    ~BlackBoxUI();
 
     int run();
 
+    // Only reads flights that are new since last time, and the last one, which may still be recording
     void updateFlights();
+    // For when flights that were already loaded have changed. Read them with fetchFlights() on the
+    // thread that changed them.
+    void reloadFlights(std::vector<Flight> flights);
+    // Hides it straight away, it's removed from the database in the background
+    void deleteFlight(uint64_t flightId);
+
     Flight& getCurrentFlight() { return m_currentFlight; }
-    void setCurrentFlightId(uint64_t flightId) { m_currentFlight = m_flights.at(flightId); }
-    std::map<uint64_t, Flight> getFlights() const { return m_flights; }
+    void setCurrentFlightId(uint64_t flightId);
+
+    // Keep a copy of the pointer for as long as it's being read, it's replaced when flights are updated
+    [[nodiscard]] const std::shared_ptr<const FlightCatalogue>& getFlights() const { return m_flights; }
 
     void setState(const State& state);
     const State& getState() const { return m_latestState; }
 
     DataStore& getDataStore() { return m_dataStore; }
+    DatabaseWatcher* getDatabaseWatcher() { return m_databaseWatcher.get(); }
+
+    const QString& getTileUrl() const { return m_tileUrl; }
+
+    // Can be called from any thread, progress is called on the calling thread
+    ReanalyseResult reanalyse(unsigned int threads = 0, const std::function<void(size_t done, size_t total)>& progress = nullptr);
 };
 
 #endif //BLACKBOX_BLACKBOX_H
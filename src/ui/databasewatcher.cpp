@@ -0,0 +1,24 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "databasewatcher.h"
+
+constexpr int CHECK_INTERVAL_MS = 1000;
+
+DatabaseWatcher::DatabaseWatcher(DataStore& dataStore, QObject* parent) : QObject(parent), m_dataStore(dataStore)
+{
+    m_version = m_dataStore.getDataVersion();
+    connect(&m_timer, &QTimer::timeout, this, &DatabaseWatcher::check);
+    m_timer.start(CHECK_INTERVAL_MS);
+}
+
+void DatabaseWatcher::check()
+{
+    uint64_t version = m_dataStore.getDataVersion();
+    if (version != m_version)
+    {
+        m_version = version;
+        emit changed();
+    }
+}
@@ -0,0 +1,34 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_DATABASEWATCHER_H
+#define BLACKBOX_DATABASEWATCHER_H
+
+#include <QObject>
+#include <QTimer>
+
+#include "blackbox/datastore.h"
+
+// Tells everything that reads from the database when the plugin has written to it, so that nothing
+// has to query it on the off chance. Checking costs a read of the WAL index in shared memory.
+class DatabaseWatcher : public QObject
+{
+    Q_OBJECT
+
+    DataStore& m_dataStore;
+    uint64_t m_version = 0;
+    QTimer m_timer;
+
+    void check();
+
+ public:
+    explicit DatabaseWatcher(DataStore& dataStore, QObject* parent = nullptr);
+    ~DatabaseWatcher() override = default;
+
+ signals:
+    // At most once a second
+    void changed();
+};
+
+#endif //BLACKBOX_DATABASEWATCHER_H
@@ -0,0 +1,52 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "flightcatalogue.h"
+
+#include <algorithm>
+
+using namespace std;
+
+static bool flightBefore(const shared_ptr<const Flight>& flight, uint64_t flightId)
+{
+    return flight->id < flightId;
+}
+
+shared_ptr<const FlightCatalogue> FlightCatalogue::merge(uint64_t fromId, vector<Flight> updates) const
+{
+    auto keep = lower_bound(m_flights.begin(), m_flights.end(), fromId, flightBefore);
+
+    vector<shared_ptr<const Flight>> flights;
+    flights.reserve((keep - m_flights.begin()) + updates.size());
+    flights.insert(flights.end(), m_flights.begin(), keep);
+    for (Flight& flight : updates)
+    {
+        flights.push_back(make_shared<const Flight>(std::move(flight)));
+    }
+    return make_shared<FlightCatalogue>(std::move(flights));
+}
+
+shared_ptr<const FlightCatalogue> FlightCatalogue::remove(uint64_t flightId) const
+{
+    vector<shared_ptr<const Flight>> flights;
+    flights.reserve(m_flights.size());
+    for (const auto& flight : m_flights)
+    {
+        if (flight->id != flightId)
+        {
+            flights.push_back(flight);
+        }
+    }
+    return make_shared<FlightCatalogue>(std::move(flights));
+}
+
+const Flight* FlightCatalogue::find(uint64_t flightId) const
+{
+    auto it = lower_bound(m_flights.begin(), m_flights.end(), flightId, flightBefore);
+    if (it == m_flights.end() || (*it)->id != flightId)
+    {
+        return nullptr;
+    }
+    return it->get();
+}
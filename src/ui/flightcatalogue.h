@@ -0,0 +1,41 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_FLIGHTCATALOGUE_H
+#define BLACKBOX_FLIGHTCATALOGUE_H
+
+#include <memory>
+#include <vector>
+
+#include "blackbox/datastore.h"
+
+// Every flight in the logbook, oldest first. It's never changed once it's made, refreshing makes a
+// new one, so a copy of the pointer can be read from anywhere for as long as it's needed. Flights
+// that haven't changed are shared with the catalogue it was made from.
+class FlightCatalogue
+{
+    std::vector<std::shared_ptr<const Flight>> m_flights;
+
+ public:
+    FlightCatalogue() = default;
+    explicit FlightCatalogue(std::vector<std::shared_ptr<const Flight>> flights) : m_flights(std::move(flights)) {}
+
+    // A new catalogue with every flight from fromId on replaced by updates, which must be in id order
+    [[nodiscard]] std::shared_ptr<const FlightCatalogue> merge(uint64_t fromId, std::vector<Flight> updates) const;
+
+    [[nodiscard]] std::shared_ptr<const FlightCatalogue> remove(uint64_t flightId) const;
+
+    // nullptr if there's no such flight
+    [[nodiscard]] const Flight* find(uint64_t flightId) const;
+    [[nodiscard]] bool contains(uint64_t flightId) const { return find(flightId) != nullptr; }
+
+    [[nodiscard]] uint64_t getLastId() const { return m_flights.empty() ? 0 : m_flights.back()->id; }
+
+    [[nodiscard]] size_t size() const { return m_flights.size(); }
+    [[nodiscard]] bool empty() const { return m_flights.empty(); }
+    [[nodiscard]] auto begin() const { return m_flights.begin(); }
+    [[nodiscard]] auto end() const { return m_flights.end(); }
+};
+
+#endif //BLACKBOX_FLIGHTCATALOGUE_H
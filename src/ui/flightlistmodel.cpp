@@ -0,0 +1,234 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "flightlistmodel.h"
+
+#include <algorithm>
+
+#include "blackbox/geo.h"
+
+using namespace std;
+
+constexpr int PAGE_SIZE = 100;
+
+static QString formatTitle(const Flight& flight)
+{
+    string title = "Flight " + to_string(flight.id) + ": ";
+
+    bool comma = false;
+    if (!flight.icaoType.empty())
+    {
+        title += flight.icaoType;
+        comma = true;
+    }
+    if (!flight.flightId.empty() && flight.icaoType != flight.flightId)
+    {
+        if (comma)
+        {
+            title += ", ";
+        }
+        title += flight.flightId;
+        comma = true;
+    }
+
+    if (!flight.origin.empty())
+    {
+        if (comma)
+        {
+            title += ", ";
+        }
+        title += "Origin: " + flight.origin;
+        comma = true;
+    }
+    if (!flight.destination.empty())
+    {
+        if (comma)
+        {
+            title += ", ";
+        }
+        title += "Destination: " + flight.destination;
+    }
+    if (flight.summary.samples > 0)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), " (%0.0f nm)", flight.summary.distance * KM_TO_NM);
+        title += buf;
+    }
+    return QString::fromStdString(title);
+}
+
+FlightListModel::FlightListModel(QObject* parent) : QAbstractListModel(parent)
+{
+}
+
+void FlightListModel::rebuild()
+{
+    beginResetModel();
+    m_flightIds.clear();
+    if (m_filter.has_value())
+    {
+        for (auto it = m_filter->rbegin(); it != m_filter->rend(); it++)
+        {
+            if (m_catalogue->contains(*it))
+            {
+                m_flightIds.push_back(*it);
+            }
+        }
+    }
+    else
+    {
+        m_flightIds.reserve(m_catalogue->size());
+        for (auto it = m_catalogue->end(); it != m_catalogue->begin();)
+        {
+            m_flightIds.push_back((*--it)->id);
+        }
+    }
+    m_fetched = min(PAGE_SIZE, static_cast<int>(m_flightIds.size()));
+    endResetModel();
+}
+
+void FlightListModel::setCatalogue(shared_ptr<const FlightCatalogue> catalogue, bool reload)
+{
+    shared_ptr<const FlightCatalogue> previous = std::move(m_catalogue);
+    m_catalogue = std::move(catalogue);
+    if (previous->empty() || reload)
+    {
+        rebuild();
+        return;
+    }
+
+    // Deleted flights
+    for (int row = static_cast<int>(m_flightIds.size()) - 1; row >= 0; row--)
+    {
+        if (m_catalogue->contains(m_flightIds[row]))
+        {
+            continue;
+        }
+        if (row < m_fetched)
+        {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_flightIds.erase(m_flightIds.begin() + row);
+            m_fetched--;
+            endRemoveRows();
+        }
+        else
+        {
+            m_flightIds.erase(m_flightIds.begin() + row);
+        }
+    }
+
+    // New flights go at the top. Searches have to be run again to find out if they match.
+    if (!m_filter.has_value())
+    {
+        uint64_t lastId = previous->getLastId();
+        vector<uint64_t> added;
+        for (auto it = m_catalogue->end(); it != m_catalogue->begin();)
+        {
+            --it;
+            if ((*it)->id <= lastId)
+            {
+                break;
+            }
+            added.push_back((*it)->id);
+        }
+        if (!added.empty())
+        {
+            beginInsertRows(QModelIndex(), 0, static_cast<int>(added.size()) - 1);
+            m_flightIds.insert(m_flightIds.begin(), added.begin(), added.end());
+            m_fetched += static_cast<int>(added.size());
+            endInsertRows();
+        }
+    }
+
+    // The last flight is read again every time, it may still be recording
+    auto it = find(m_flightIds.begin(), m_flightIds.begin() + m_fetched, previous->getLastId());
+    if (it != m_flightIds.begin() + m_fetched)
+    {
+        QModelIndex changed = index(static_cast<int>(it - m_flightIds.begin()));
+        emit dataChanged(changed, changed);
+    }
+}
+
+void FlightListModel::setFilter(vector<uint64_t> flightIds)
+{
+    m_filter = std::move(flightIds);
+    rebuild();
+}
+
+void FlightListModel::clearFilter()
+{
+    if (!m_filter.has_value())
+    {
+        return;
+    }
+    m_filter.reset();
+    rebuild();
+}
+
+uint64_t FlightListModel::getFlightId(int row) const
+{
+    if (row < 0 || row >= m_fetched)
+    {
+        return 0;
+    }
+    return m_flightIds[row];
+}
+
+int FlightListModel::findRow(uint64_t flightId)
+{
+    auto it = find(m_flightIds.begin(), m_flightIds.end(), flightId);
+    if (it == m_flightIds.end())
+    {
+        return -1;
+    }
+
+    int row = static_cast<int>(it - m_flightIds.begin());
+    while (m_fetched <= row)
+    {
+        fetchMore(QModelIndex());
+    }
+    return row;
+}
+
+int FlightListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_fetched;
+}
+
+QVariant FlightListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_fetched)
+    {
+        return {};
+    }
+
+    uint64_t flightId = m_flightIds[index.row()];
+    if (role == Qt::UserRole)
+    {
+        return QVariant::fromValue(flightId);
+    }
+    if (role == Qt::DisplayRole)
+    {
+        const Flight* flight = m_catalogue->find(flightId);
+        return flight != nullptr ? formatTitle(*flight) : QString();
+    }
+    return {};
+}
+
+bool FlightListModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && m_fetched < static_cast<int>(m_flightIds.size());
+}
+
+void FlightListModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent))
+    {
+        return;
+    }
+    int count = min(PAGE_SIZE, static_cast<int>(m_flightIds.size()) - m_fetched);
+    beginInsertRows(QModelIndex(), m_fetched, m_fetched + count - 1);
+    m_fetched += count;
+    endInsertRows();
+}
@@ -0,0 +1,56 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_FLIGHTLISTMODEL_H
+#define BLACKBOX_FLIGHTLISTMODEL_H
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <QAbstractListModel>
+
+#include "flightcatalogue.h"
+
+// Flights for a list or combo box, newest first. Rows are handed out a page at a time as the view
+// scrolls, and titles are only made for the rows that are actually drawn.
+class FlightListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    std::shared_ptr<const FlightCatalogue> m_catalogue = std::make_shared<FlightCatalogue>();
+
+    // Search results, if there's a search
+    std::optional<std::vector<uint64_t>> m_filter;
+
+    // Every flight that could be shown, in row order, and how many of them the view has been given
+    std::vector<uint64_t> m_flightIds;
+    int m_fetched = 0;
+
+    void rebuild();
+
+ public:
+    explicit FlightListModel(QObject* parent = nullptr);
+    ~FlightListModel() override = default;
+
+    // Only the differences from the last catalogue are passed on to the view, unless reloading
+    // because flights that were already there have changed
+    void setCatalogue(std::shared_ptr<const FlightCatalogue> catalogue, bool reload = false);
+
+    void setFilter(std::vector<uint64_t> flightIds);
+    void clearFilter();
+
+    [[nodiscard]] uint64_t getFlightId(int row) const;
+
+    // Fetches as many rows as it takes to get to it. Returns -1 if the flight isn't in the list.
+    int findRow(uint64_t flightId);
+
+    [[nodiscard]] int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    [[nodiscard]] QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    [[nodiscard]] bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+};
+
+#endif //BLACKBOX_FLIGHTLISTMODEL_H
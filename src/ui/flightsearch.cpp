@@ -0,0 +1,76 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "flightsearch.h"
+
+using namespace std;
+
+FlightSearch::FlightSearch(string dbPath, QObject* parent) : QObject(parent), m_dbPath(std::move(dbPath))
+{
+    m_worker = thread([this]() { work(); });
+}
+
+FlightSearch::~FlightSearch()
+{
+    {
+        lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_signal.notify_one();
+    m_worker.join();
+}
+
+void FlightSearch::search(const FlightQuery& query)
+{
+    {
+        lock_guard lock(m_mutex);
+        m_query = query;
+        m_hasQuery = true;
+    }
+    m_signal.notify_one();
+}
+
+void FlightSearch::work()
+{
+    DataStore dataStore;
+    bool open = false;
+
+    while (true)
+    {
+        unique_lock lock(m_mutex);
+        m_signal.wait(lock, [this]() { return m_stopping || m_hasQuery; });
+        if (m_stopping)
+        {
+            break;
+        }
+        FlightQuery query = m_query;
+        m_hasQuery = false;
+        lock.unlock();
+
+        if (!open)
+        {
+            open = dataStore.init(m_dbPath);
+            if (!open)
+            {
+                printf("FlightSearch: Failed to open database\n");
+                continue;
+            }
+        }
+
+        auto flightIds = dataStore.searchFlights(query);
+        QMetaObject::invokeMethod(this, [this, flightIds]()
+        {
+            // A newer search will be along in a moment
+            bool stale;
+            {
+                lock_guard lock(m_mutex);
+                stale = m_hasQuery;
+            }
+            if (!stale)
+            {
+                emit finished(flightIds);
+            }
+        });
+    }
+}
@@ -0,0 +1,46 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_FLIGHTSEARCH_H
+#define BLACKBOX_FLIGHTSEARCH_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QObject>
+
+#include "blackbox/datastore.h"
+
+// Runs flight searches on its own connection so typing never waits on the database. Only the
+// latest search matters, so one that's replaced before it starts is never run.
+class FlightSearch : public QObject
+{
+    Q_OBJECT
+
+    std::string m_dbPath;
+
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_signal;
+    bool m_stopping = false;
+    bool m_hasQuery = false;
+    FlightQuery m_query;
+
+    void work();
+
+ public:
+    explicit FlightSearch(std::string dbPath, QObject* parent = nullptr);
+    ~FlightSearch() override;
+
+    void search(const FlightQuery& query);
+
+ signals:
+    // Emitted on the GUI thread
+    void finished(const std::vector<uint64_t>& flightIds);
+};
+
+#endif //BLACKBOX_FLIGHTSEARCH_H
@@ -5,8 +5,9 @@
 #include "mainwindow.h"
 #include "map/routemap.h"
 
-#include <QDir>
-#include <QNetworkDiskCache>
+#include <cinttypes>
+
+#include <QNetworkAccessManager>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QComboBox>
@@ -16,25 +17,23 @@
 #include <QGroupBox>
 #include <qicon.h>
 #include <QMessageBox>
-#include <QStandardPaths>
+#include <QProgressDialog>
+#include <QActionGroup>
+#include <QSignalBlocker>
 
+#include "flightlistmodel.h"
+#include "flightsearch.h"
 #include "liveindicator.h"
+#include "profilechart.h"
+#include "timelinewidget.h"
+#include "blackbox/geo.h"
 
 using namespace std;
 
-void setupCachedNetworkAccessManager(QObject* parent)
+void setupNetworkAccessManager(QObject* parent)
 {
-    QDir("cacheDir");
-    auto cache = new QNetworkDiskCache(parent);
-
-    auto cacheLocations = QStandardPaths::standardLocations(QStandardPaths::CacheLocation);
-    auto cacheDir = cacheLocations.first() + "/mapcache";
-    printf("Setting map cache dir: %s\n", cacheDir.toStdString().c_str());
-    cache->setCacheDirectory(cacheDir);
-
-    cache->setMaximumCacheSize(100 * 1024 * 1024);
+    // Tiles are kept in the map's MBTiles store, so there's no need for a disk cache as well
     auto manager = new QNetworkAccessManager(parent);
-    manager->setCache(cache);
     QGV::setNetworkManager(manager);
 }
 
@@ -54,6 +53,27 @@ MainWindow::MainWindow(BlackBoxUI* bbui) : m_blackBoxUI(bbui)
     auto menu = menuBar();
     auto fileMenu = menu->addMenu("File");
     fileMenu->addAction("Delete");
+    fileMenu->addSeparator();
+    auto reanalyseAction = fileMenu->addAction("Re-analyse All Flights...");
+    connect(reanalyseAction, &QAction::triggered, this, &MainWindow::reanalyseFlights);
+
+    auto viewMenu = menu->addMenu("View");
+    auto modeGroup = new QActionGroup(this);
+    for (auto [name, mode] : {
+        pair{"Selected Flight", MapMode::ROUTE},
+        pair{"All Flights", MapMode::ALL},
+        pair{"Heatmap", MapMode::HEATMAP}})
+    {
+        auto modeAction = viewMenu->addAction(name);
+        modeAction->setCheckable(true);
+        modeAction->setChecked(mode == MapMode::ROUTE);
+        modeGroup->addAction(modeAction);
+        connect(modeAction, &QAction::triggered, this, [this, mode]()
+        {
+            m_map->setMode(mode);
+            m_map->showFlight(m_blackBoxUI->getCurrentFlight().id);
+        });
+    }
 
     setCentralWidget(new QWidget());
     auto layout = new QVBoxLayout();
@@ -63,12 +83,47 @@ MainWindow::MainWindow(BlackBoxUI* bbui) : m_blackBoxUI(bbui)
     auto toolbar = addToolBar("Toolbar");
     toolbar->addWidget(m_liveIndicator = new LiveIndicator());
 
+    m_flightModel = new FlightListModel(this);
     m_flightComboBox = new QComboBox();
+    m_flightComboBox->setModel(m_flightModel);
     toolbar->addWidget(m_flightComboBox);
 
+    m_searchEdit = new QLineEdit();
+    m_searchEdit->setPlaceholderText("Search airports, aircraft, flight codes");
+    m_searchEdit->setClearButtonEnabled(true);
+    toolbar->addWidget(m_searchEdit);
+
+    m_dateComboBox = new QComboBox();
+    for (auto [name, days] : {
+        pair{"Any Time", 0},
+        pair{"Last 7 Days", 7},
+        pair{"Last 30 Days", 30},
+        pair{"Last 12 Months", 365}})
+    {
+        m_dateComboBox->addItem(name, days);
+    }
+    toolbar->addWidget(m_dateComboBox);
+
+    m_aircraftComboBox = new QComboBox();
+    toolbar->addWidget(m_aircraftComboBox);
+
+    // Wait for a pause in typing before searching
+    m_search = new FlightSearch(m_blackBoxUI->getDataStore().getPath(), this);
+    m_searchTimer.setSingleShot(true);
+    m_searchTimer.setInterval(150);
+    connect(&m_searchTimer, &QTimer::timeout, this, &MainWindow::search);
+    connect(m_searchEdit, &QLineEdit::textChanged, this, [this]() { m_searchTimer.start(); });
+    connect(m_dateComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::search);
+    connect(m_aircraftComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::search);
+    connect(m_search, &FlightSearch::finished, this, &MainWindow::showFlights);
+
     auto refreshAction = new QAction("Refresh");
     refreshAction->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::ViewRefresh));
     toolbar->addAction(refreshAction);
+    connect(refreshAction, &QAction::triggered, this, [this]() { m_blackBoxUI->updateFlights(); });
+
+    // Only read the flights again once the plugin has written something
+    connect(m_blackBoxUI->getDatabaseWatcher(), &DatabaseWatcher::changed, this, [this]() { m_blackBoxUI->updateFlights(); });
 
     auto editAction = new QAction("Edit");
     editAction->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::DocumentProperties));
@@ -79,11 +134,24 @@ MainWindow::MainWindow(BlackBoxUI* bbui) : m_blackBoxUI(bbui)
     connect(deleteAction, &QAction::triggered, this, &MainWindow::deleteCurrentFlight);
     toolbar->addAction(deleteAction);
 
-    setupCachedNetworkAccessManager(this);
+    setupNetworkAccessManager(this);
 
     m_map = new RouteMap(m_blackBoxUI);
     layout->addWidget(m_map);
 
+    m_timeline = new TimelineWidget(m_blackBoxUI->getDataStore());
+    layout->addWidget(m_timeline);
+    connect(m_timeline, &TimelineWidget::stateChanged, this, [this](const State& state)
+    {
+        m_map->showCursor(state);
+        m_profileChart->setCursor(state.timestamp);
+        showState(state);
+    });
+
+    m_profileChart = new ProfileChart(m_blackBoxUI->getDataStore().getPath());
+    layout->addWidget(m_profileChart);
+    connect(m_profileChart, &ProfileChart::clicked, m_timeline, &TimelineWidget::seek);
+
     auto hbox = new QHBoxLayout();
     hbox->setAlignment(Qt::AlignLeft);
     layout->addLayout(hbox);
@@ -115,17 +183,18 @@ MainWindow::MainWindow(BlackBoxUI* bbui) : m_blackBoxUI(bbui)
         infoBox1Layout->addWidget(new QLabel("<b>Heading</b>:"));
         infoBox1Layout->addWidget(m_headingLabel = new QLabel(""));
     }
+    {
+        auto infoBox1 = new QGroupBox();
+        hbox->addWidget(infoBox1);
+        auto infoBox1Layout = new QHBoxLayout();
+        infoBox1->setLayout(infoBox1Layout);
+        infoBox1->setAlignment(Qt::AlignLeft);
+        infoBox1Layout->addWidget(new QLabel("<b>Flight</b>:"));
+        infoBox1Layout->addWidget(m_summaryLabel = new QLabel(""));
+    }
 
 
-    connect(m_flightComboBox, &QComboBox::currentIndexChanged, this, [this](int index)
-    {
-        if (index >= 0)
-        {
-            auto id = m_flightComboBox->itemData(index).toULongLong();
-            m_blackBoxUI->setCurrentFlightId(id);
-            m_map->showFlight(id);
-        }
-    });
+    connect(m_flightComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::flightSelected);
 
     printf("MainWindow::MainWindow: Done!\n");
 }
@@ -144,10 +213,70 @@ bool MainWindow::init()
 }
 
 
+void MainWindow::flightSelected(int index)
+{
+    uint64_t id = m_flightModel->getFlightId(index);
+    if (id == 0)
+    {
+        return;
+    }
+    m_shownFlightId = id;
+    m_blackBoxUI->setCurrentFlightId(id);
+    const FlightSummary& summary = m_blackBoxUI->getCurrentFlight().summary;
+    m_timeline->setFlight(id, summary.startTime, summary.endTime);
+    m_map->hideCursor();
+    m_map->showFlight(id);
+    m_profileChart->setFlight(id);
+    updateSummary();
+}
+
+void MainWindow::selectCurrentFlight()
+{
+    int row = m_flightModel->findRow(m_blackBoxUI->getCurrentFlight().id);
+    if (row < 0 && m_flightModel->rowCount() > 0)
+    {
+        row = 0;
+    }
+
+    // Refreshing shouldn't reload the flight that's already shown
+    {
+        QSignalBlocker blocker(m_flightComboBox);
+        m_flightComboBox->setCurrentIndex(row);
+    }
+    if (row >= 0 && m_flightModel->getFlightId(row) != m_shownFlightId)
+    {
+        flightSelected(row);
+    }
+    updateSummary();
+}
+
 void MainWindow::updateState()
 {
     auto state = m_blackBoxUI->getState();
 
+    // Don't fight the timeline while it's being played back
+    if (!m_timeline->isPlaying())
+    {
+        showState(state);
+    }
+
+    auto now = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    auto diff = now - state.timestamp;
+    bool live = diff < 10000; // 10 seconds
+    m_liveIndicator->setLive(live);
+
+    if (live)
+    {
+        m_map->prefetchAhead(state);
+        if (m_blackBoxUI->getCurrentFlight().id == m_map->getLiveFlightId())
+        {
+            m_timeline->setEndTime(state.timestamp);
+        }
+    }
+}
+
+void MainWindow::showState(const State& state)
+{
     char buf[1024];
     snprintf(buf, sizeof(buf), "%0.0f feet", state.position.altitude);
     m_altitudeLabel->setText(QString(buf));
@@ -157,69 +286,123 @@ void MainWindow::updateState()
 
     snprintf(buf, sizeof(buf), "%.0f°", state.yaw);
     m_headingLabel->setText(QString(buf));
+}
 
-    auto now = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
-    auto diff = now - state.timestamp;
-    bool live = diff < 10000; // 10 seconds
-    m_liveIndicator->setLive(live);
+string formatSummary(const FlightSummary& summary)
+{
+    if (summary.samples == 0)
+    {
+        return "";
+    }
+
+    char buf[1024];
+    uint64_t minutes = summary.getDuration() / 60000;
+    uint64_t airborneMinutes = summary.airborneTime / 60000;
+    int len = snprintf(
+        buf,
+        sizeof(buf),
+        "%0.0f nm, %" PRIu64 "h %02" PRIu64 "m (%" PRIu64 "h %02" PRIu64 "m airborne), max %0.0f feet",
+        summary.distance * KM_TO_NM,
+        minutes / 60,
+        minutes % 60,
+        airborneMinutes / 60,
+        airborneMinutes % 60,
+        summary.maxAltitude);
+    if (summary.landed)
+    {
+        snprintf(buf + len, sizeof(buf) - len, ", landed at %0.0f fpm", summary.touchdownFPM);
+    }
+    return buf;
 }
 
-void MainWindow::updateFlights()
+void MainWindow::updateSummary()
 {
-    map<uint64_t, Flight> flights = m_blackBoxUI->getFlights();
-    m_flightComboBox->clear();
+    m_summaryLabel->setText(QString::fromStdString(formatSummary(m_blackBoxUI->getCurrentFlight().summary)));
+}
 
-    int idx = 0;
-    int selectedIndex = 0;
-    uint64_t currentFlightId = m_blackBoxUI->getCurrentFlight().id;
-    for (auto [flightId, flight] : flights)
+void MainWindow::updateFlights(bool reload)
+{
+    updateFacets();
     {
-        string title = "Flight " + to_string(flight.id) + ": ";
+        QSignalBlocker blocker(m_flightComboBox);
+        m_flightModel->setCatalogue(m_blackBoxUI->getFlights(), reload);
+    }
 
-        bool comma = false;
-        if (!flight.icaoType.empty())
-        {
-            title += flight.icaoType;
-            comma = true;
-        }
-        if (!flight.flightId.empty() && flight.icaoType != flight.flightId)
-        {
-            if (comma)
-            {
-                title += ", ";
-            }
-            title += flight.flightId;
-            comma = true;
-        }
+    FlightQuery query = getQuery();
+    if (!query.empty())
+    {
+        // The results will be along shortly
+        m_search->search(query);
+    }
+    else
+    {
+        QSignalBlocker blocker(m_flightComboBox);
+        m_flightModel->clearFilter();
+    }
+    selectCurrentFlight();
+}
 
-        if (!flight.origin.empty())
-        {
-            if (comma)
-            {
-                title += ", ";
-            }
-            title += "Origin: " + flight.origin;
-            comma = true;
-        }
-        if (!flight.destination.empty())
-        {
-            if (comma)
-            {
-                title += ", ";
-            }
-            title += "Destination: " + flight.destination;
-        }
-        m_flightComboBox->addItem(QString(title.c_str()), QVariant::fromValue(flight.id));
+FlightQuery MainWindow::getQuery() const
+{
+    FlightQuery query;
+    query.text = m_searchEdit->text().trimmed().toStdString();
 
-        if (flight.id == currentFlightId)
+    int days = m_dateComboBox->currentData().toInt();
+    if (days > 0)
+    {
+        auto now = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        query.fromTime = static_cast<uint64_t>(now) - static_cast<uint64_t>(days) * 24 * 60 * 60 * 1000;
+    }
+
+    query.aircraftType = m_aircraftComboBox->currentData().toString().toStdString();
+    return query;
+}
+
+void MainWindow::search()
+{
+    m_searchTimer.stop();
+    updateFlights();
+}
+
+void MainWindow::updateFacets()
+{
+    // While a flight's recording only its summary changes, the types are the same as last time
+    const auto& flights = m_blackBoxUI->getFlights();
+    if (flights->size() == m_facetFlights && flights->getLastId() == m_facetLastId)
+    {
+        return;
+    }
+    m_facetFlights = flights->size();
+    m_facetLastId = flights->getLastId();
+
+    map<string, int> counts;
+    for (const auto& flight : *flights)
+    {
+        if (!flight->icaoType.empty())
         {
-            printf("updateFlights: Found current Flight: %lld -> %d\n", flight.id, idx);
-            selectedIndex = idx;
+            counts[flight->icaoType]++;
         }
+    }
 
-        idx++;
+    QSignalBlocker blocker(m_aircraftComboBox);
+    QString selected = m_aircraftComboBox->currentData().toString();
+    m_aircraftComboBox->clear();
+    m_aircraftComboBox->addItem("All Aircraft", QString());
+    for (const auto& [type, count] : counts)
+    {
+        QString name = QString::fromStdString(type);
+        m_aircraftComboBox->addItem(name + " (" + QString::number(count) + ")", name);
     }
-    m_flightComboBox->setCurrentIndex(selectedIndex);
+    m_aircraftComboBox->setCurrentIndex(max(0, m_aircraftComboBox->findData(selected)));
+}
+
+void MainWindow::showFlights(const vector<uint64_t>& flightIds)
+{
+    {
+        QSignalBlocker blocker(m_flightComboBox);
+        m_flightModel->setFilter(flightIds);
+    }
+    selectCurrentFlight();
 }
 
 void MainWindow::deleteCurrentFlight()
@@ -234,7 +417,73 @@ void MainWindow::deleteCurrentFlight()
     {
         // Well, we'd better delete it, then
         m_map->clearRoutes();
-        m_blackBoxUI->getDataStore().deleteFlight(m_blackBoxUI->getCurrentFlight().id);
-        m_blackBoxUI->updateFlights();
+        uint64_t flightId = m_blackBoxUI->getCurrentFlight().id;
+        m_map->removeFlight(flightId);
+        m_blackBoxUI->deleteFlight(flightId);
+    }
+}
+
+void MainWindow::reanalyseFlights()
+{
+    if (m_reanalyseThread != nullptr)
+    {
+        return;
     }
+
+    auto progressDialog = new QProgressDialog("Re-analysing flights...", QString(), 0, 0, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->show();
+
+    m_reanalyseThread = new thread([this, progressDialog]()
+    {
+        ReanalyseResult result = m_blackBoxUI->reanalyse(0, [progressDialog](size_t done, size_t total)
+        {
+            QMetaObject::invokeMethod(progressDialog, [progressDialog, done, total]()
+            {
+                progressDialog->setMaximum(static_cast<int>(total));
+                progressDialog->setValue(static_cast<int>(done));
+            });
+        });
+
+        // Any flight's summary may have changed, not just the new ones
+        vector<Flight> flights;
+        DataStore dataStore;
+        if (dataStore.init(m_blackBoxUI->getDataStore().getPath()))
+        {
+            flights = dataStore.fetchFlights();
+        }
+
+        QMetaObject::invokeMethod(this, [this, progressDialog, result, flights = std::move(flights)]() mutable
+        {
+            m_reanalyseThread->join();
+            delete m_reanalyseThread;
+            m_reanalyseThread = nullptr;
+            progressDialog->deleteLater();
+
+            if (!flights.empty())
+            {
+                m_blackBoxUI->reloadFlights(std::move(flights));
+            }
+            m_map->showFlight(m_blackBoxUI->getCurrentFlight().id);
+
+            char buf[1024];
+            if (result.success)
+            {
+                snprintf(
+                    buf,
+                    sizeof(buf),
+                    "Re-analysed %zu flights in %0.1f seconds (%0.1f flights/second), %zu states changed.",
+                    result.flights,
+                    result.seconds,
+                    result.getFlightsPerSecond(),
+                    result.changed);
+                QMessageBox::information(this, "Re-analyse Flights", buf);
+            }
+            else
+            {
+                QMessageBox::warning(this, "Re-analyse Flights", "Failed to re-analyse flights, see the log for details.");
+            }
+        });
+    });
 }
@@ -7,14 +7,22 @@
 
 #include <QComboBox>
 #include <QLabel>
+#include <QLineEdit>
 #include <QMainWindow>
 #include <QSystemTrayIcon>
+#include <QTimer>
+
+#include <thread>
 
 #include "blackbox.h"
 #include "blackbox/datastore.h"
 
+class FlightListModel;
+class FlightSearch;
 class LiveIndicator;
+class ProfileChart;
 class RouteMap;
+class TimelineWidget;
 
 class MainWindow : public QMainWindow
 {
@@ -26,17 +34,42 @@ class MainWindow : public QMainWindow
 
     LiveIndicator* m_liveIndicator;
     QComboBox* m_flightComboBox = nullptr;
+    FlightListModel* m_flightModel = nullptr;
+    uint64_t m_shownFlightId = 0;
+
+    QLineEdit* m_searchEdit = nullptr;
+    QComboBox* m_dateComboBox = nullptr;
+    QComboBox* m_aircraftComboBox = nullptr;
+    size_t m_facetFlights = 0;
+    uint64_t m_facetLastId = 0;
+    FlightSearch* m_search = nullptr;
+    QTimer m_searchTimer;
 
     QLabel* m_altitudeLabel = nullptr;
     QLabel* m_speedLabel = nullptr;
     QLabel* m_headingLabel = nullptr;
+    QLabel* m_summaryLabel = nullptr;
 
     RouteMap* m_map;
+    TimelineWidget* m_timeline = nullptr;
+    ProfileChart* m_profileChart = nullptr;
+
+    std::thread* m_reanalyseThread = nullptr;
 
     void deleteCurrentFlight();
+    void updateSummary();
+    void showState(const State& state);
+    void reanalyseFlights();
+
+    [[nodiscard]] FlightQuery getQuery() const;
+    void search();
+    void updateFacets();
+    void showFlights(const std::vector<uint64_t>& flightIds);
+    void flightSelected(int index);
+    void selectCurrentFlight();
 
 public:
-    void updateFlights();
+    void updateFlights(bool reload = false);
 
     explicit MainWindow(BlackBoxUI* blackBoxUI);
     ~MainWindow() override;
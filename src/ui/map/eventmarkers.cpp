@@ -0,0 +1,311 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "eventmarkers.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QPainter>
+
+#include <QGeoView/QGVCamera.h>
+#include <QGeoView/QGVMap.h>
+
+#include "iconatlas.h"
+
+using namespace std;
+
+// Width of the whole Web Mercator world in metres
+constexpr double WORLD_SIZE = 2.0 * M_PI * 6378137.0;
+
+constexpr int TILE_SIZE = 256;
+
+// Past this, go through every cell rather than every place a cell could be
+constexpr size_t MAX_LOOKUPS = 4096;
+
+static uint64_t cellKey(int64_t column, int64_t row)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(row)) << 32) | static_cast<uint32_t>(column);
+}
+
+EventMarkers::EventMarkers()
+{
+    setFlag(QGV::ItemFlag::Clickable);
+}
+
+int EventMarkers::scaleToLevel(double scale)
+{
+    // The same as the tile zoom level, so a cell is between CELL_SIZE and twice that on screen
+    double level = floor(log2(scale * WORLD_SIZE / TILE_SIZE));
+    return clamp(static_cast<int>(level), 0, LEVELS - 1);
+}
+
+double EventMarkers::cellSize(int level)
+{
+    return WORLD_SIZE / static_cast<double>(1 << level) / (TILE_SIZE / CELL_SIZE);
+}
+
+void EventMarkers::add(uint64_t flightId, MarkerType type, const State& state)
+{
+    Event event;
+    event.flightId = flightId;
+    event.type = type;
+    event.position = QGV::GeoPos(state.position.latitude, state.position.longitude);
+    event.fpm = state.fpm;
+    m_events.push_back(event);
+    m_flightEvents[flightId]++;
+
+    // Without a map, we don't know where it goes yet
+    if (getMap() != nullptr)
+    {
+        m_events.back().projected = getMap()->getProjection()->geoToProj(event.position);
+        addToLevels(m_events.size() - 1);
+        updateVisible();
+    }
+}
+
+void EventMarkers::removeFlight(uint64_t flightId)
+{
+    auto it = m_flightEvents.find(flightId);
+    if (it == m_flightEvents.end())
+    {
+        return;
+    }
+    m_flightEvents.erase(it);
+
+    erase_if(m_events, [flightId](const Event& event) { return event.flightId == flightId; });
+    rebuild();
+}
+
+void EventMarkers::clear()
+{
+    m_events.clear();
+    m_flightEvents.clear();
+    rebuild();
+}
+
+void EventMarkers::addToLevels(size_t index)
+{
+    const Event& event = m_events[index];
+    const QPointF& p = event.projected;
+    for (int level = 0; level < LEVELS; level++)
+    {
+        const double size = cellSize(level);
+        auto column = static_cast<int64_t>(floor(p.x() / size));
+        auto row = static_cast<int64_t>(floor(p.y() / size));
+        Cell& cell = m_levels[level][cellKey(column, row)];
+        if (cell.count() == 0)
+        {
+            cell.first = index;
+            cell.bounds = QRectF(p, QSizeF(0.0, 0.0));
+        }
+        else
+        {
+            cell.bounds.setLeft(min(cell.bounds.left(), p.x()));
+            cell.bounds.setRight(max(cell.bounds.right(), p.x()));
+            cell.bounds.setTop(min(cell.bounds.top(), p.y()));
+            cell.bounds.setBottom(max(cell.bounds.bottom(), p.y()));
+        }
+        if (event.type == MarkerType::LANDING)
+        {
+            cell.landings++;
+        }
+        else
+        {
+            cell.takeOffs++;
+        }
+        cell.sum += p;
+    }
+}
+
+void EventMarkers::rebuild()
+{
+    for (auto& cells : m_levels)
+    {
+        cells.clear();
+    }
+
+    QGVMap* geoMap = getMap();
+    if (geoMap != nullptr)
+    {
+        for (size_t i = 0; i < m_events.size(); i++)
+        {
+            m_events[i].projected = geoMap->getProjection()->geoToProj(m_events[i].position);
+            addToLevels(i);
+        }
+    }
+    updateVisible();
+}
+
+void EventMarkers::updateVisible()
+{
+    m_visible.clear();
+    m_shape = QPainterPath();
+
+    QGVMap* geoMap = getMap();
+    if (geoMap != nullptr && !m_events.empty())
+    {
+        const QGVCameraState camera = geoMap->getCamera();
+        m_scale = camera.scale();
+        m_level = scaleToLevel(m_scale);
+
+        // Markers just outside still poke in to the view
+        const double size = cellSize(m_level);
+        const QRectF view = camera.projRect().adjusted(-size, -size, size, size);
+        const auto& cells = m_levels[m_level];
+
+        const auto left = static_cast<int64_t>(floor(view.left() / size));
+        const auto right = static_cast<int64_t>(floor(view.right() / size));
+        const auto top = static_cast<int64_t>(floor(view.top() / size));
+        const auto bottom = static_cast<int64_t>(floor(view.bottom() / size));
+        const auto lookups = static_cast<size_t>((right - left + 1) * (bottom - top + 1));
+        if (lookups <= min(cells.size(), MAX_LOOKUPS))
+        {
+            for (int64_t row = top; row <= bottom; row++)
+            {
+                for (int64_t column = left; column <= right; column++)
+                {
+                    auto it = cells.find(cellKey(column, row));
+                    if (it != cells.end())
+                    {
+                        m_visible.push_back(&it->second);
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (const auto& [key, cell] : cells)
+            {
+                if (view.contains(cell.centre()))
+                {
+                    m_visible.push_back(&cell);
+                }
+            }
+        }
+
+        const double radius = ICON_SIZE / 2.0 / m_scale;
+        for (const Cell* cell : m_visible)
+        {
+            m_shape.addEllipse(cell->centre(), radius, radius);
+        }
+    }
+
+    resetBoundary();
+    refresh();
+}
+
+const EventMarkers::Cell* EventMarkers::cellAt(const QPointF& projPos) const
+{
+    const double radius = ICON_SIZE / 2.0 / m_scale;
+    for (const Cell* cell : m_visible)
+    {
+        QPointF d = cell->centre() - projPos;
+        if (QPointF::dotProduct(d, d) <= radius * radius)
+        {
+            return cell;
+        }
+    }
+    return nullptr;
+}
+
+void EventMarkers::onProjection(QGVMap* geoMap)
+{
+    QGVDrawItem::onProjection(geoMap);
+    rebuild();
+}
+
+void EventMarkers::onCamera(const QGVCameraState& oldState, const QGVCameraState& newState)
+{
+    QGVDrawItem::onCamera(oldState, newState);
+    updateVisible();
+}
+
+QPainterPath EventMarkers::projShape() const
+{
+    return m_shape;
+}
+
+void EventMarkers::projPaint(QPainter* painter)
+{
+    const IconAtlas& atlas = IconAtlas::instance();
+    QFont font = painter->font();
+    font.setPixelSize(10);
+    font.setBold(true);
+
+    for (const Cell* cell : m_visible)
+    {
+        // Work in pixels so the markers are the same size at every zoom
+        painter->save();
+        painter->translate(cell->centre());
+        painter->scale(1.0 / m_scale, 1.0 / m_scale);
+
+        const QImage& icon = cell->landings > 0 ? atlas.getLanding() : atlas.getAirport();
+        painter->drawImage(QRectF(-ICON_SIZE / 2.0, -ICON_SIZE / 2.0, ICON_SIZE, ICON_SIZE), icon);
+
+        if (cell->count() > 1)
+        {
+            QRectF badge(ICON_SIZE / 2.0 - 8.0, -ICON_SIZE / 2.0 - 6.0, 16.0, 16.0);
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(QColor(200, 40, 40));
+            painter->drawEllipse(badge);
+
+            painter->setFont(font);
+            painter->setPen(Qt::white);
+            QString text = cell->count() > 99 ? "99+" : QString::number(cell->count());
+            painter->drawText(badge, Qt::AlignCenter, text);
+        }
+        painter->restore();
+    }
+}
+
+QString EventMarkers::projTooltip(const QPointF& projPos) const
+{
+    const Cell* cell = cellAt(projPos);
+    if (cell == nullptr)
+    {
+        return "";
+    }
+
+    char buf[1024];
+    if (cell->count() > 1)
+    {
+        snprintf(buf, sizeof(buf), "%d landings, %d take-offs", cell->landings, cell->takeOffs);
+    }
+    else if (cell->landings == 1)
+    {
+        snprintf(buf, sizeof(buf), "FPM: %0.2f", m_events[cell->first].fpm);
+    }
+    else
+    {
+        snprintf(buf, sizeof(buf), "Take-off");
+    }
+    return buf;
+}
+
+void EventMarkers::projOnMouseClick(const QPointF& projPos)
+{
+    const Cell* cell = cellAt(projPos);
+    if (cell == nullptr)
+    {
+        return;
+    }
+
+    if (cell->count() == 1)
+    {
+        printf("EventMarkers::projOnMouseClick: FPM=%0.2f\n", m_events[cell->first].fpm);
+        return;
+    }
+
+    // Zoom in until they come apart, even if they're all at the same airport
+    const double minSize = cellSize(min(m_level + 1, LEVELS - 1));
+    QRectF target = cell->bounds;
+    if (target.width() < minSize || target.height() < minSize)
+    {
+        const QPointF centre = target.center();
+        const double size = max({target.width(), target.height(), minSize});
+        target = QRectF(centre.x() - size / 2.0, centre.y() - size / 2.0, size, size);
+    }
+    getMap()->flyTo(QGVCameraActions(getMap()).scaleTo(getMap()->getProjection()->projToGeo(target)));
+}
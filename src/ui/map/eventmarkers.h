@@ -0,0 +1,96 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_EVENTMARKERS_H
+#define BLACKBOX_EVENTMARKERS_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <QGeoView/QGVDrawItem.h>
+
+#include "blackbox/state.h"
+
+enum class MarkerType
+{
+    LANDING,
+    TAKE_OFF
+};
+
+// Every landing and take-off on the map as a single item. They're bucketed in to a grid for each
+// zoom level as they're added, so drawing only has to look at the cells in view and nearby events
+// are shown as one marker with a count until you zoom in far enough to tell them apart.
+class EventMarkers : public QGVDrawItem
+{
+ public:
+    // Level 18 cells are ~40m across, past that everything is drawn on its own anyway
+    static constexpr int LEVELS = 19;
+
+    // How big a cell is on screen
+    static constexpr int CELL_SIZE = 64;
+    static constexpr int ICON_SIZE = 20;
+
+ private:
+    struct Event
+    {
+        uint64_t flightId;
+        MarkerType type;
+        QGV::GeoPos position;
+        QPointF projected;
+        float fpm;
+    };
+
+    struct Cell
+    {
+        int landings = 0;
+        int takeOffs = 0;
+        // The markers go in the middle of what they stand for
+        QPointF sum;
+        QRectF bounds;
+        // For the tooltip when it's on its own
+        size_t first = 0;
+
+        [[nodiscard]] int count() const { return landings + takeOffs; }
+        [[nodiscard]] QPointF centre() const { return sum / count(); }
+    };
+
+    std::vector<Event> m_events;
+    std::map<uint64_t, size_t> m_flightEvents;
+    std::array<std::unordered_map<uint64_t, Cell>, LEVELS> m_levels;
+
+    // What's in view at the moment, worked out when the camera moves
+    int m_level = 0;
+    double m_scale = 1.0;
+    std::vector<const Cell*> m_visible;
+    QPainterPath m_shape;
+
+    static int scaleToLevel(double scale);
+    static double cellSize(int level);
+
+    void addToLevels(size_t index);
+    void rebuild();
+    void updateVisible();
+    [[nodiscard]] const Cell* cellAt(const QPointF& projPos) const;
+
+    void onProjection(QGVMap* geoMap) override;
+    void onCamera(const QGVCameraState& oldState, const QGVCameraState& newState) override;
+    QPainterPath projShape() const override;
+    void projPaint(QPainter* painter) override;
+    QString projTooltip(const QPointF& projPos) const override;
+    void projOnMouseClick(const QPointF& projPos) override;
+
+ public:
+    EventMarkers();
+
+    void add(uint64_t flightId, MarkerType type, const State& state);
+    void removeFlight(uint64_t flightId);
+    void clear();
+
+    [[nodiscard]] size_t getEventCount() const { return m_events.size(); }
+};
+
+#endif //BLACKBOX_EVENTMARKERS_H
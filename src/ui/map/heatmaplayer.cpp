@@ -0,0 +1,376 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "heatmaplayer.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+
+#include <QGeoView/Raster/QGVImage.h>
+
+#include "../blackbox.h"
+
+using namespace std;
+
+// While a flight's being recorded the database changes every second, which is far more often than
+// the heatmap needs to be redrawn. This is still often enough to see a live flight's track fill in.
+constexpr int UPDATE_DELAY_MS = 10000;
+
+// How often to show progress while a big logbook is being read in
+constexpr chrono::seconds PROGRESS_INTERVAL(2);
+
+constexpr int TILE_SIZE = 256;
+
+// Keeps track of which tiles are on the map so they can be redrawn
+class HeatmapTile : public QGVImage
+{
+ public:
+    HeatmapLayer* m_layer;
+    TileId m_tile;
+
+    HeatmapTile(HeatmapLayer* layer, const TileId& tile) : m_layer(layer), m_tile(tile)
+    {
+        m_layer->m_tiles.insert(this);
+    }
+
+    ~HeatmapTile() override
+    {
+        if (m_layer != nullptr)
+        {
+            m_layer->m_tiles.erase(this);
+        }
+    }
+};
+
+static TileId toTileId(const QGV::GeoTilePos& tilePos)
+{
+    return TileId{tilePos.zoom(), tilePos.pos().x(), tilePos.pos().y()};
+}
+
+// Transparent through blue and yellow to red
+static QRgb colour(double t)
+{
+    struct Stop
+    {
+        double t;
+        int r, g, b, a;
+    };
+    static const Stop stops[] = {
+        {0.0, 0, 0, 255, 0},
+        {0.25, 0, 128, 255, 140},
+        {0.5, 0, 255, 128, 180},
+        {0.75, 255, 255, 0, 210},
+        {1.0, 255, 0, 0, 240},
+    };
+
+    t = clamp(t, 0.0, 1.0);
+    size_t i = 1;
+    while (i < size(stops) - 1 && t > stops[i].t)
+    {
+        i++;
+    }
+    const Stop& a = stops[i - 1];
+    const Stop& b = stops[i];
+    double f = (t - a.t) / (b.t - a.t);
+    auto mix = [f](int x, int y) { return static_cast<int>(x + (y - x) * f); };
+    return qRgba(mix(a.r, b.r), mix(a.g, b.g), mix(a.b, b.b), mix(a.a, b.a));
+}
+
+static QImage emptyTile()
+{
+    QImage image(1, 1, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    return image;
+}
+
+HeatmapLayer::HeatmapLayer(BlackBoxUI* blackBoxUI, const string& gridPath) :
+    m_blackBoxUI(blackBoxUI),
+    m_gridPath(gridPath)
+{
+    setName("Heatmap");
+    m_updateTimer.setSingleShot(true);
+    connect(&m_updateTimer, &QTimer::timeout, this, &HeatmapLayer::update);
+    connect(m_blackBoxUI->getDatabaseWatcher(), &DatabaseWatcher::changed, this, [this]()
+    {
+        if (m_shown && !m_updateTimer.isActive())
+        {
+            m_updateTimer.start(UPDATE_DELAY_MS);
+        }
+    });
+}
+
+HeatmapLayer::~HeatmapLayer()
+{
+    m_cancelled = true;
+    if (m_updateThread != nullptr)
+    {
+        m_updateThread->join();
+        delete m_updateThread;
+    }
+
+    // QGV deletes the tiles after we've gone
+    for (HeatmapTile* tile : m_tiles)
+    {
+        tile->m_layer = nullptr;
+    }
+}
+
+int HeatmapLayer::minZoomlevel() const
+{
+    return 0;
+}
+
+int HeatmapLayer::maxZoomlevel() const
+{
+    return 19;
+}
+
+int HeatmapLayer::scaleToZoom(double scale) const
+{
+    // The same as QGVLayerOSM
+    const double scaleChange = 1 / scale;
+    return static_cast<int>((20.0 - log(scaleChange) * M_LOG2E) + 0.5);
+}
+
+void HeatmapLayer::setShown(bool shown)
+{
+    setVisible(shown);
+    m_shown = shown;
+    if (shown)
+    {
+        update();
+    }
+    else
+    {
+        m_updateTimer.stop();
+    }
+}
+
+void HeatmapLayer::request(const QGV::GeoTilePos& tilePos)
+{
+    // QGV doesn't expect the tile before request() returns
+    TileId tile = toTileId(tilePos);
+    m_requests.insert(tile);
+    QTimer::singleShot(0, this, [this, tile]() { deliver(tile); });
+}
+
+void HeatmapLayer::cancel(const QGV::GeoTilePos& tilePos)
+{
+    m_requests.erase(toTileId(tilePos));
+}
+
+void HeatmapLayer::deliver(const TileId& tile)
+{
+    // It may have been cancelled while we were waiting
+    if (m_requests.erase(tile) == 0)
+    {
+        return;
+    }
+
+    QImage image = render(tile);
+    QGV::GeoTilePos tilePos(tile.zoom, QPoint(tile.x, tile.y));
+    auto item = new HeatmapTile(this, tile);
+    item->setGeometry(tilePos.toGeoRect());
+    item->loadImage(image.isNull() ? emptyTile() : image);
+    onTile(tilePos, item);
+}
+
+QImage HeatmapLayer::render(const TileId& tile) const
+{
+    // Past the deepest level, zoom in to part of a tile
+    const int level = min(tile.zoom, DensityGrid::MAX_LEVEL);
+    const int depth = tile.zoom - level;
+    DensityGrid::Tile bins;
+    if (!m_grid.getTile(level, tile.x >> depth, tile.y >> depth, bins))
+    {
+        return {};
+    }
+
+    const double scale = 1.0 / log1p(max(1u, m_grid.getMaxCount(level)));
+    QImage image(DensityGrid::BINS, DensityGrid::BINS, QImage::Format_ARGB32);
+    for (int y = 0; y < DensityGrid::BINS; y++)
+    {
+        auto* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < DensityGrid::BINS; x++)
+        {
+            uint32_t count = bins[y * DensityGrid::BINS + x];
+            line[x] = count == 0 ? qRgba(0, 0, 0, 0) : colour(log1p(count) * scale);
+        }
+    }
+
+    if (depth > 0)
+    {
+        const int mask = (1 << depth) - 1;
+        const int size = max(1, DensityGrid::BINS >> depth);
+        const int x = ((tile.x & mask) * DensityGrid::BINS) >> depth;
+        const int y = ((tile.y & mask) * DensityGrid::BINS) >> depth;
+        image = image.copy(x, y, size, size);
+    }
+    return image.scaled(TILE_SIZE, TILE_SIZE, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+void HeatmapLayer::refresh()
+{
+    for (HeatmapTile* tile : m_tiles)
+    {
+        QImage image = render(tile->m_tile);
+        tile->loadImage(image.isNull() ? emptyTile() : image);
+    }
+}
+
+void HeatmapLayer::update()
+{
+    if (m_updateThread != nullptr)
+    {
+        m_updateAgain = true;
+        return;
+    }
+
+    set<uint64_t> removals = std::move(m_removals);
+    m_removals.clear();
+
+    set<uint64_t> flightIds;
+    for (const auto& flight : *m_blackBoxUI->getFlights())
+    {
+        if (!removals.contains(flight->id))
+        {
+            flightIds.insert(flight->id);
+        }
+    }
+    string dbPath = m_blackBoxUI->getDataStore().getPath();
+
+    m_updateThread = new thread([this, flightIds, removals, dbPath]()
+    {
+        if (!m_loaded)
+        {
+            m_grid.load(m_gridPath);
+            m_loaded = true;
+        }
+
+        DataStore dataStore;
+        if (!dataStore.init(dbPath))
+        {
+            QMetaObject::invokeMethod(this, [this]() { updateFinished(false); });
+            return;
+        }
+
+        size_t removed = 0;
+        for (uint64_t flightId : removals)
+        {
+            uint64_t lastTimestamp = m_grid.getLastTimestamp(flightId);
+            if (lastTimestamp == 0 || m_cancelled)
+            {
+                continue;
+            }
+
+            // Only what was added. The purger takes the newest states first, so if the last one
+            // we added has already gone then so have others.
+            auto states = dataStore.fetchUpdates(flightId, 0);
+            auto end = find_if(states.begin(), states.end(), [lastTimestamp](const State& state)
+            {
+                return state.timestamp > lastTimestamp;
+            });
+            if (end == states.begin() || prev(end)->timestamp != lastTimestamp)
+            {
+                printf("HeatmapLayer: Flight %" PRIu64 " has already been purged, starting again\n", flightId);
+                m_grid.clear();
+                removed++;
+                break;
+            }
+
+            size_t count = end - states.begin();
+            vector<double> latitudes(count);
+            vector<double> longitudes(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                latitudes[i] = states[i].position.latitude;
+                longitudes[i] = states[i].position.longitude;
+            }
+            m_grid.removeFlight(flightId, latitudes.data(), longitudes.data(), count);
+            removed++;
+        }
+
+        // If a flight's gone without us knowing, there's no way to take it out again
+        auto known = m_grid.getFlights();
+        for (const auto& [flightId, lastTimestamp] : known)
+        {
+            if (!flightIds.contains(flightId))
+            {
+                printf("HeatmapLayer: Flight %" PRIu64 " has been deleted, starting again\n", flightId);
+                m_grid.clear();
+                known.clear();
+                break;
+            }
+        }
+
+        size_t added = 0;
+        auto lastProgress = chrono::steady_clock::now();
+        for (uint64_t flightId : flightIds)
+        {
+            if (m_cancelled)
+            {
+                break;
+            }
+
+            auto it = known.find(flightId);
+            auto states = dataStore.fetchUpdates(flightId, it != known.end() ? it->second : 0);
+            if (states.empty())
+            {
+                continue;
+            }
+
+            vector<double> latitudes(states.size());
+            vector<double> longitudes(states.size());
+            for (size_t i = 0; i < states.size(); i++)
+            {
+                latitudes[i] = states[i].position.latitude;
+                longitudes[i] = states[i].position.longitude;
+            }
+            m_grid.addFlight(flightId, latitudes.data(), longitudes.data(), states.size(), states.back().timestamp);
+            added++;
+
+            if (chrono::steady_clock::now() - lastProgress > PROGRESS_INTERVAL)
+            {
+                QMetaObject::invokeMethod(this, [this]() { refresh(); });
+                lastProgress = chrono::steady_clock::now();
+            }
+        }
+
+        bool changed = added > 0 || removed > 0;
+        if (changed)
+        {
+            m_grid.save(m_gridPath);
+        }
+        QMetaObject::invokeMethod(this, [this, changed]() { updateFinished(changed); });
+    });
+}
+
+void HeatmapLayer::updateFinished(bool changed)
+{
+    m_updateThread->join();
+    delete m_updateThread;
+    m_updateThread = nullptr;
+
+    if (changed)
+    {
+        refresh();
+    }
+    if (m_updateAgain)
+    {
+        m_updateAgain = false;
+        update();
+    }
+}
+
+void HeatmapLayer::removeFlight(uint64_t flightId)
+{
+    if (m_grid.getLastTimestamp(flightId) == 0)
+    {
+        return;
+    }
+
+    m_removals.insert(flightId);
+    update();
+}
@@ -0,0 +1,80 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_HEATMAPLAYER_H
+#define BLACKBOX_HEATMAPLAYER_H
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <QImage>
+#include <QTimer>
+#include <QGeoView/QGVLayerTiles.h>
+
+#include "blackbox/densitygrid.h"
+#include "tilestore.h"
+
+class BlackBoxUI;
+class HeatmapTile;
+
+// Where the logbook has been, drawn from a DensityGrid as map tiles so it doesn't matter how many
+// flights there are. The grid is kept in the cache between runs and only flights, or the parts of
+// them, that it hasn't seen yet are read in, on a background thread.
+class HeatmapLayer : public QGVLayerTiles
+{
+    Q_OBJECT
+
+    friend class HeatmapTile;
+
+    BlackBoxUI* m_blackBoxUI;
+    std::string m_gridPath;
+    DensityGrid m_grid;
+
+    // Tiles waiting to be drawn and the ones on the map, so they can be redrawn as flights come in
+    std::set<TileId> m_requests;
+    std::set<HeatmapTile*> m_tiles;
+
+    std::thread* m_updateThread = nullptr;
+    std::atomic<bool> m_cancelled = false;
+    std::atomic<bool> m_loaded = false;
+    bool m_updateAgain = false;
+
+    // Deleted flights to take back out, next time the update thread runs
+    std::set<uint64_t> m_removals;
+
+    bool m_shown = false;
+    QTimer m_updateTimer;
+
+    void deliver(const TileId& tile);
+    void updateFinished(bool changed);
+
+ protected:
+    int minZoomlevel() const override;
+    int maxZoomlevel() const override;
+    int scaleToZoom(double scale) const override;
+    void request(const QGV::GeoTilePos& tilePos) override;
+    void cancel(const QGV::GeoTilePos& tilePos) override;
+
+ public:
+    HeatmapLayer(BlackBoxUI* blackBoxUI, const std::string& gridPath);
+    ~HeatmapLayer() override;
+
+    // Keeps up with new flights while it's being shown
+    void setShown(bool shown);
+
+    // Reads in anything new since the last time
+    void update();
+
+    // Call before the flight is deleted, it's taken out on the update thread
+    void removeFlight(uint64_t flightId);
+
+    [[nodiscard]] QImage render(const TileId& tile) const;
+
+    // Redraws every tile on the map
+    void refresh();
+};
+
+#endif //BLACKBOX_HEATMAPLAYER_H
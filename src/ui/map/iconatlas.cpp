@@ -0,0 +1,61 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "iconatlas.h"
+
+#include <cmath>
+
+#include <QPainter>
+
+// Twice the size they're shown at, so they're still sharp on high DPI screens
+constexpr int PLANE_SIZE = 80;
+constexpr int MARKER_SIZE = 40;
+
+static QImage loadIcon(const QString& path, int size)
+{
+    QImage image(path);
+    if (image.isNull())
+    {
+        printf("IconAtlas: Failed to load %s\n", path.toStdString().c_str());
+        image = QImage(size, size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        return image;
+    }
+    return image
+        .convertToFormat(QImage::Format_ARGB32_Premultiplied)
+        .scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
+
+IconAtlas::IconAtlas()
+{
+    QImage plane = loadIcon(":/images/plane-red.png", PLANE_SIZE);
+    for (int i = 0; i < HEADINGS; i++)
+    {
+        // Rotate about the centre without changing the size, so every heading lines up the same
+        QImage rotated(PLANE_SIZE, PLANE_SIZE, QImage::Format_ARGB32_Premultiplied);
+        rotated.fill(Qt::transparent);
+        QPainter painter(&rotated);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.translate(PLANE_SIZE / 2.0, PLANE_SIZE / 2.0);
+        painter.rotate(i * HEADING_STEP);
+        painter.drawImage(QPointF(-plane.width() / 2.0, -plane.height() / 2.0), plane);
+        painter.end();
+        m_planes[i] = rotated;
+    }
+
+    m_landing = loadIcon(":/images/landing.png", MARKER_SIZE);
+    m_airport = loadIcon(":/images/airport.png", MARKER_SIZE);
+}
+
+const IconAtlas& IconAtlas::instance()
+{
+    static const IconAtlas atlas;
+    return atlas;
+}
+
+int IconAtlas::getHeadingIndex(float heading)
+{
+    int index = static_cast<int>(lround(heading / HEADING_STEP)) % HEADINGS;
+    return index < 0 ? index + HEADINGS : index;
+}
@@ -0,0 +1,40 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_ICONATLAS_H
+#define BLACKBOX_ICONATLAS_H
+
+#include <array>
+
+#include <QImage>
+
+// Every icon the map uses, loaded from the resources once and scaled to the size they're drawn at.
+// The aircraft is rendered at every HEADING_STEP degrees up front so following it is just a lookup.
+class IconAtlas
+{
+ public:
+    static constexpr int HEADING_STEP = 5;
+    static constexpr int HEADINGS = 360 / HEADING_STEP;
+
+ private:
+    std::array<QImage, HEADINGS> m_planes;
+    QImage m_landing;
+    QImage m_airport;
+
+    IconAtlas();
+
+ public:
+    // Needs the QApplication to have been created
+    static const IconAtlas& instance();
+
+    // Which of the pre-rotated aircraft is nearest to heading
+    static int getHeadingIndex(float heading);
+
+    [[nodiscard]] const QImage& getPlane(int headingIndex) const { return m_planes[headingIndex]; }
+    [[nodiscard]] const QImage& getPlane(float heading) const { return m_planes[getHeadingIndex(heading)]; }
+    [[nodiscard]] const QImage& getLanding() const { return m_landing; }
+    [[nodiscard]] const QImage& getAirport() const { return m_airport; }
+};
+
+#endif //BLACKBOX_ICONATLAS_H
@@ -11,9 +11,12 @@
 #include <QTimer>
 
 #include <QGeoView/QGVCamera.h>
+#include <QGeoView/QGVProjectionEPSG3857.h>
 
-#include "landingicon.h"
+#include "eventmarkers.h"
+#include "iconatlas.h"
 #include "../blackbox.h"
+#include "blackbox/geo.h"
 
 using namespace std;
 
@@ -21,66 +24,45 @@ Route::Route(RouteMap* map, uint64_t flightId) : m_map(map), m_flightId(flightId
 {
     setFlag(QGV::ItemFlag::Clickable);
 
-    m_planeIcon = new QImage("../data/images/plane-red.png");
-
     m_positionIcon = new QGVIcon();
-    m_positionIcon->loadImage(*m_planeIcon);
+    m_positionIcon->loadImage(IconAtlas::instance().getPlane(m_headingIndex));
     m_positionIcon->setVisible(false);
     m_map->getItemsLayer()->addItem(m_positionIcon);
     m_items.push_back(m_positionIcon);
-
-    m_updateTimer = new QTimer(this);
-    connect(m_updateTimer, &QTimer::timeout, this, &Route::updateRoute);
-    m_updateTimer->start(1000);
 }
 
-void Route::addPoints(std::vector<Point> points)
+void Route::addPoints(const std::vector<Point>& points)
 {
-    m_points.insert(m_points.end(), points.begin(), points.end());
-    printf("addPoints: Added %ld points, we now have %ld\n", points.size(), m_points.size());
+    const size_t added = m_track.size();
 
-    m_maxAltitude = 1;
-    if (!m_points.empty())
+    vector<double> latitudes(points.size());
+    vector<double> longitudes(points.size());
+    vector<float> altitudes(points.size());
+    vector<float> headings(points.size());
+    for (size_t i = 0; i < points.size(); i++)
     {
-        m_boundingRect = QGV::GeoRect(m_points[0].position, m_points[0].position);
-
-        double minLat = m_points[0].position.latitude();
-        double maxLat = m_points[0].position.latitude();
-        double minLon = m_points[0].position.longitude();
-        double maxLon = m_points[0].position.longitude();
+        latitudes[i] = points[i].position.latitude();
+        longitudes[i] = points[i].position.longitude();
+        altitudes[i] = points[i].altitude;
+        headings[i] = points[i].heading;
+    }
+    m_track.append(latitudes.data(), longitudes.data(), altitudes.data(), headings.data(), points.size());
+    printf("addPoints: Added %ld points, we now have %ld\n", points.size(), m_track.size());
 
-        for (const auto& point : m_points)
-        {
-            if (point.position.latitude() < minLat)
-            {
-                minLat = point.position.latitude();
-            }
-            if (point.position.latitude() > maxLat)
-            {
-                maxLat = point.position.latitude();
-            }
-            if (point.position.longitude() < minLon)
-            {
-                minLon = point.position.longitude();
-            }
-            if (point.position.longitude() > maxLon)
-            {
-                maxLon = point.position.longitude();
-            }
-            if (point.altitude > m_maxAltitude)
-            {
-                m_maxAltitude = point.altitude;
-            }
-        }
+    const GeoBounds& bounds = m_track.getBounds();
+    if (!bounds.empty)
+    {
         m_boundingRect = QGV::GeoRect(
-            QGV::GeoPos(minLat, minLon),
-            QGV::GeoPos(maxLat, maxLon));
+            QGV::GeoPos(bounds.minLatitude, bounds.minLongitude),
+            QGV::GeoPos(bounds.maxLatitude, bounds.maxLongitude));
     }
 
-    // Geo coordinates need to be converted manually again to projection
-    if (getMap() != nullptr)
+    // The projection hasn't changed, so the existing points are still where they were
+    QGVMap* geoMap = getMap();
+    if (geoMap != nullptr)
     {
-        onProjection(getMap());
+        project(geoMap, added, latitudes.data(), longitudes.data());
+        updateProjectedBounds(geoMap);
 
         // Now we can inform QGV about changes for this
         resetBoundary();
@@ -90,7 +72,7 @@ void Route::addPoints(std::vector<Point> points)
 
 void Route::clear()
 {
-    m_points.clear();
+    m_track.clear();
     m_boundingRect = QGV::GeoRect();
     refresh();
 }
@@ -102,21 +84,60 @@ QGV::GeoRect Route::getRect() const
 
 Point Route::getLastPosition()
 {
-    if (!m_points.empty())
+    Point point;
+    if (!m_track.empty())
     {
-        return m_points.back();
+        size_t last = m_track.size() - 1;
+        point.position = QGV::GeoPos(m_track.getLatitude(last), m_track.getLongitude(last));
+        point.altitude = m_track.getAltitude(last);
+        point.heading = m_track.getHeading(last);
     }
-    return Point();
+    return point;
 }
 
 void Route::onProjection(QGVMap* geoMap)
 {
     QGVDrawItem::onProjection(geoMap);
-    for (auto& point : m_points)
+
+    vector<double> latitudes(m_track.getLatitudes(), m_track.getLatitudes() + m_track.size());
+    vector<double> longitudes(m_track.getLongitudes(), m_track.getLongitudes() + m_track.size());
+    project(geoMap, 0, latitudes.data(), longitudes.data());
+    updateProjectedBounds(geoMap);
+}
+
+// Projects the track from point from onwards, given the positions of those points
+void Route::project(QGVMap* geoMap, size_t from, const double* latitudes, const double* longitudes)
+{
+    auto projection = geoMap->getProjection();
+    const size_t count = m_track.size() - from;
+    vector<double> x(count);
+    vector<double> y(count);
+
+    // The map is nearly always Web Mercator, which we can do all in one go
+    if (dynamic_cast<const QGVProjectionEPSG3857*>(projection) != nullptr)
     {
-        point.projected = geoMap->getProjection()->geoToProj(point.position);
+        toWebMercator(latitudes, longitudes, count, x.data(), y.data());
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            QPointF projected = projection->geoToProj(QGV::GeoPos(latitudes[i], longitudes[i]));
+            x[i] = projected.x();
+            y[i] = projected.y();
+        }
     }
 
+    if (from == 0 && count > 0)
+    {
+        // Everything is stored relative to the start so floats are still precise enough
+        m_track.setProjectionOrigin(x[0], y[0]);
+    }
+    m_track.setProjected(from, x.data(), y.data(), count);
+}
+
+void Route::updateProjectedBounds(QGVMap* geoMap)
+{
     m_boundingRectProjected = QRectF(
         geoMap->getProjection()->geoToProj(m_boundingRect.topLeft()),
         geoMap->getProjection()->geoToProj(m_boundingRect.bottomRight()));
@@ -124,21 +145,24 @@ void Route::onProjection(QGVMap* geoMap)
 
 QPainterPath Route::projShape() const
 {
+    // Only wanted for the boundary and hit tests, so build it from the track when asked rather than
+    // keeping a second copy of every point around
     QPainterPath path;
-
-    if (!m_points.empty())
+    const size_t count = m_track.size();
+    if (count > 0)
     {
-        path.moveTo(m_points.front().projected);
-        for (auto it = m_points.begin(); it != m_points.end(); ++it)
+        const float* x = m_track.getProjectedX();
+        const float* y = m_track.getProjectedY();
+        const double originX = m_track.getOriginX();
+        const double originY = m_track.getOriginY();
+
+        path.reserve(static_cast<int>(count));
+        path.moveTo(originX + x[0], originY + y[0]);
+        for (size_t i = 1; i < count; i++)
         {
-            if (it != m_points.begin())
-            {
-                path.lineTo(it->projected);
-            }
+            path.lineTo(originX + x[i], originY + y[i]);
         }
     }
-
-
     return path;
 }
 
@@ -165,21 +189,25 @@ void Route::projPaint(QPainter* painter)
     auto colour1 =  QColor(0, 255, 0);
     auto colour2 =  QColor(82, 78, 221);
     //auto colour2 = QColor(87, 190, 55);
-    if (m_points.size() > 1)
+    const size_t count = m_track.size();
+    if (count > 1)
     {
-        Point previous;
-        //QPainterPath path(m_points.front().projected);
-        for (auto it = m_points.begin(); it != m_points.end(); ++it)
+        const float* x = m_track.getProjectedX();
+        const float* y = m_track.getProjectedY();
+        const float* altitudes = m_track.getAltitudes();
+        const double originX = m_track.getOriginX();
+        const double originY = m_track.getOriginY();
+        const float maxAltitude = max(1.0f, m_track.getMaxAltitude());
+
+        QPointF previous(originX + x[0], originY + y[0]);
+        for (size_t i = 1; i < count; i++)
         {
-            if (it != m_points.begin())
-            {
-                pen.setColor(interpolate(colour2, colour1, it->altitude / m_maxAltitude));
-                painter->setPen(pen);
-                painter->drawLine(previous.projected, it->projected);
-            }
-            previous = *it;
+            QPointF current(originX + x[i], originY + y[i]);
+            pen.setColor(interpolate(colour2, colour1, max(0.0f, altitudes[i]) / maxAltitude));
+            painter->setPen(pen);
+            painter->drawLine(previous, current);
+            previous = current;
         }
-        //painter->drawPath(path);
     }
 
     // Custom item select indicator
@@ -243,17 +271,25 @@ QString Route::projTooltip(const QPointF& projPos) const
 
     auto geo = getMap()->getProjection()->projToGeo(projPos);
 
+    const float* latitudes = m_track.getLatitudes();
+    const float* longitudes = m_track.getLongitudes();
     QGV::GeoPos previous;
-    for (auto& point : m_points)
+    for (size_t i = 0; i < m_track.size(); i++)
     {
-double d = pointdistfromline2D(previous, point.position, geo);
+        QGV::GeoPos position(latitudes[i], longitudes[i]);
+        double d = pointdistfromline2D(previous, position, geo);
         if (d < 0.5)
         {
-char buf[1024];
-            snprintf(buf, 1024, "Distance: %.2f, altitude: %0.2f", d, point.altitude);
-    return buf;
+            char buf[1024];
+            snprintf(
+                buf,
+                1024,
+                "Distance: %.1f nm, altitude: %0.0f ft",
+                m_track.getDistance(i) * KM_TO_NM,
+                m_track.getAltitude(i));
+            return buf;
         }
-        previous = point.position;
+        previous = position;
     }
     return "";
 }
@@ -278,13 +314,13 @@ void Route::projOnMouseClick(const QPointF& projPos)
     }
 }
 
-void Route::updateRoute()
+bool Route::updateRoute()
 {
     BlackBoxUI* ui = m_map->getBlackBoxUI();
     auto stateUpdates = ui->getDataStore().fetchUpdates(m_flightId, m_lastTimestamp);
     if (stateUpdates.empty())
     {
-        return;
+        return false;
     }
 
     vector<Point> points;
@@ -303,39 +339,28 @@ void Route::updateRoute()
 
         if (state.flightPhase == FlightPhase::LANDING && m_lastState.flightPhase != FlightPhase::LANDING)
         {
-            auto* item = new LandingIcon(state);
-            item->setGeometry(QGV::GeoPos(p.position.latitude(), p.position.longitude()), QSizeF(20, 20));
-            m_items.push_back(item);
-            m_map->getItemsLayer()->addItem(item);
-            item->bringToFront();
+            m_map->getMarkers()->add(m_flightId, MarkerType::LANDING, state);
         }
         if (state.flightPhase == FlightPhase::TAKE_OFF && m_lastState.flightPhase != FlightPhase::TAKE_OFF)
         {
-            QImage planeIcon("../data/images/airport.png");
-            auto* item = new QGVIcon();
-            item->loadImage(planeIcon);
-            item->setGeometry(QGV::GeoPos(p.position.latitude(), p.position.longitude()), QSizeF(20, 20));
-            m_items.push_back(item);
-            m_map->getItemsLayer()->addItem(item);
-            item->bringToFront();
+            m_map->getMarkers()->add(m_flightId, MarkerType::TAKE_OFF, state);
         }
 
         m_lastState = state;
     }
 
-    ui->setState(m_lastState);
-
     if (!points.empty())
     {
         addPoints(points);
 
         Point point = getLastPosition();
 
-        QTransform transform;
-        transform.rotate(point.heading);
-
-        QImage image = m_planeIcon->transformed(transform);
-        m_positionIcon->loadImage(image);
+        int headingIndex = IconAtlas::getHeadingIndex(point.heading);
+        if (headingIndex != m_headingIndex)
+        {
+            m_headingIndex = headingIndex;
+            m_positionIcon->loadImage(IconAtlas::instance().getPlane(m_headingIndex));
+        }
 
         m_positionIcon->setGeometry(
             QGV::GeoPos(point.position.latitude(), point.position.longitude()),
@@ -343,6 +368,7 @@ void Route::updateRoute()
         m_positionIcon->setVisible(true);
         m_positionIcon->bringToFront();
     }
+    return true;
 }
 
 void Route::showRoute()
@@ -404,11 +430,10 @@ void Route::showRoute()
 
 void Route::removeFromMap()
 {
-    m_updateTimer->stop();
     for (auto item : m_items)
     {
         m_map->getItemsLayer()->removeItem(item);
     }
     m_items.clear();
-
+    m_map->getMarkers()->removeFlight(m_flightId);
 }
@@ -8,17 +8,17 @@
 #include <QGeoView/QGVDrawItem.h>
 
 #include <QBrush>
+#include <QPainterPath>
 
 #include "routemap.h"
 #include "blackbox/state.h"
+#include "blackbox/track.h"
 
 struct Point
 {
     QGV::GeoPos position;
-    float altitude;
-    float heading;
-
-    QPointF projected;
+    float altitude = 0.0f;
+    float heading = 0.0f;
 };
 
 class Route :  public QGVDrawItem
@@ -26,20 +26,20 @@ class Route :  public QGVDrawItem
     RouteMap* m_map = nullptr;
     uint64_t m_flightId;
 
-    std::vector<Point> m_points;
+    Track<float> m_track;
     QGV::GeoRect m_boundingRect;
     QRectF m_boundingRectProjected;
 
-    float m_maxAltitude = 0;
+    void project(QGVMap* geoMap, size_t from, const double* latitudes, const double* longitudes);
+    void updateProjectedBounds(QGVMap* geoMap);
 
     State m_lastState;
     uint64_t m_lastTimestamp = 0;
     std::vector<QGVItem*> m_items;
 
-    QImage* m_planeIcon = nullptr;
     QGVIcon* m_positionIcon = nullptr;
-
-    QTimer* m_updateTimer;
+    // Which of the atlas' pre-rotated aircraft it's showing
+    int m_headingIndex = 0;
 
     void onProjection(QGVMap* geoMap) override;
     QPainterPath projShape() const override;
@@ -53,14 +53,17 @@ public:
     Route(RouteMap* map, uint64_t flightId);
 
     //void set(std::vector<Point> points);
-    void addPoints(std::vector<Point> points);
+    void addPoints(const std::vector<Point>& points);
     void clear();
 
     QGV::GeoRect getRect() const;
 
     Point getLastPosition();
+    const Track<float>& getTrack() const { return m_track; }
 
-    void updateRoute();
+    // Adds anything recorded since the last update. Returns false if there wasn't anything new.
+    bool updateRoute();
+    const State& getLastState() const { return m_lastState; }
 
     void showRoute();
 
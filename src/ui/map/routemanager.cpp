@@ -0,0 +1,190 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "routemanager.h"
+#include "route.h"
+#include "routemap.h"
+
+#include <chrono>
+
+#include <QGeoView/QGVLayer.h>
+#include <QGeoView/QGVProjection.h>
+
+#include "../blackbox.h"
+
+using namespace std;
+
+// Once the most recent flight hasn't had anything new for this long, it's not live any more
+constexpr int64_t LIVE_TIMEOUT_MS = 10000;
+
+// How long to spend loading routes before letting the UI have a go
+constexpr chrono::milliseconds LOAD_BUDGET(30);
+
+// Wait for the map to stop moving before working out what's in view
+constexpr int VIEW_SETTLE_MS = 100;
+
+static int64_t now()
+{
+    return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+RouteManager::RouteManager(RouteMap* map, QGVLayer* layer) : QObject(map), m_map(map), m_layer(layer)
+{
+    // Nothing can have been added to a route unless the database has changed
+    connect(m_map->getBlackBoxUI()->getDatabaseWatcher(), &DatabaseWatcher::changed, this, &RouteManager::poll);
+
+    m_loadTimer.setSingleShot(true);
+    connect(&m_loadTimer, &QTimer::timeout, this, &RouteManager::loadQueued);
+
+    m_viewTimer.setSingleShot(true);
+    connect(&m_viewTimer, &QTimer::timeout, this, &RouteManager::updateView);
+    connect(m_map, &QGVMap::areaChanged, this, [this]()
+    {
+        if (m_showAll)
+        {
+            m_viewTimer.start(VIEW_SETTLE_MS);
+        }
+    });
+}
+
+RouteManager::~RouteManager()
+{
+    clear();
+}
+
+void RouteManager::setShowAll(bool showAll)
+{
+    m_showAll = showAll;
+    if (m_showAll)
+    {
+        updateView();
+    }
+    else
+    {
+        m_loadQueue.clear();
+        m_queued.clear();
+    }
+}
+
+void RouteManager::clear()
+{
+    m_loadQueue.clear();
+    m_queued.clear();
+    for (auto& [flightId, route] : m_routes)
+    {
+        route->removeFromMap();
+        m_layer->removeItem(route);
+        delete route;
+    }
+    m_routes.clear();
+}
+
+Route* RouteManager::getRoute(uint64_t flightId) const
+{
+    auto it = m_routes.find(flightId);
+    return it != m_routes.end() ? it->second : nullptr;
+}
+
+Route* RouteManager::load(uint64_t flightId)
+{
+    Route* route = getRoute(flightId);
+    if (route != nullptr)
+    {
+        return route;
+    }
+
+    route = new Route(m_map, flightId);
+    route->updateRoute();
+    m_layer->addItem(route);
+    m_routes.emplace(flightId, route);
+    return route;
+}
+
+uint64_t RouteManager::getLiveFlightId() const
+{
+    if (m_liveFlightId != 0 && now() - m_lastLiveUpdate < LIVE_TIMEOUT_MS)
+    {
+        return m_liveFlightId;
+    }
+    return 0;
+}
+
+void RouteManager::poll()
+{
+    BlackBoxUI* ui = m_map->getBlackBoxUI();
+    uint64_t latestFlightId = ui->getFlights()->getLastId();
+    if (latestFlightId == 0)
+    {
+        return;
+    }
+
+    // Older flights can't get any new states, and if it's not on the map there's nothing to update
+    Route* route = getRoute(latestFlightId);
+    if (route == nullptr || !route->updateRoute())
+    {
+        return;
+    }
+
+    m_liveFlightId = latestFlightId;
+    m_lastLiveUpdate = now();
+    if (ui->getCurrentFlight().id == latestFlightId)
+    {
+        ui->setState(route->getLastState());
+    }
+}
+
+void RouteManager::updateView()
+{
+    if (!m_showAll)
+    {
+        return;
+    }
+
+    QGV::GeoRect view = m_map->getProjection()->projToGeo(m_map->getCamera().projRect());
+    double south = min(view.latBottom(), view.latTop());
+    double north = max(view.latBottom(), view.latTop());
+    double west = min(view.lonLeft(), view.lonRight());
+    double east = max(view.lonLeft(), view.lonRight());
+
+    // The summaries already know where every flight went, so nothing has to be read to find out
+    auto flights = m_map->getBlackBoxUI()->getFlights();
+    for (const auto& flight : *flights)
+    {
+        uint64_t flightId = flight->id;
+        const FlightSummary& summary = flight->summary;
+        if (summary.samples == 0 || m_routes.contains(flightId) || m_queued.contains(flightId))
+        {
+            continue;
+        }
+        if (summary.maxLatitude < south || summary.minLatitude > north ||
+            summary.maxLongitude < west || summary.minLongitude > east)
+        {
+            continue;
+        }
+        m_loadQueue.push_back(flightId);
+        m_queued.insert(flightId);
+    }
+
+    if (!m_loadQueue.empty())
+    {
+        m_loadTimer.start(0);
+    }
+}
+
+void RouteManager::loadQueued()
+{
+    auto start = chrono::steady_clock::now();
+    while (!m_loadQueue.empty() && chrono::steady_clock::now() - start < LOAD_BUDGET)
+    {
+        uint64_t flightId = m_loadQueue.front();
+        m_loadQueue.pop_front();
+        m_queued.erase(flightId);
+        load(flightId);
+    }
+
+    if (!m_loadQueue.empty())
+    {
+        m_loadTimer.start(0);
+    }
+}
@@ -0,0 +1,68 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_ROUTEMANAGER_H
+#define BLACKBOX_ROUTEMANAGER_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <set>
+
+#include <QObject>
+#include <QTimer>
+
+class QGVLayer;
+class Route;
+class RouteMap;
+
+// Owns every route on the map. Only the most recent flight can still be recording, so that's the
+// only one that gets polled, and only when the database has changed. Everything else is loaded once,
+// and in ALL mode only once it's in view.
+class RouteManager : public QObject
+{
+    Q_OBJECT
+
+    RouteMap* m_map;
+    QGVLayer* m_layer;
+
+    std::map<uint64_t, Route*> m_routes;
+    bool m_showAll = false;
+
+    // Flights that have come in to view and are waiting to be loaded
+    std::deque<uint64_t> m_loadQueue;
+    std::set<uint64_t> m_queued;
+
+    QTimer m_loadTimer;
+    QTimer m_viewTimer;
+
+    uint64_t m_liveFlightId = 0;
+    int64_t m_lastLiveUpdate = 0;
+
+    void poll();
+    void loadQueued();
+    void updateView();
+
+ public:
+    RouteManager(RouteMap* map, QGVLayer* layer);
+    ~RouteManager() override;
+
+    // Show every flight rather than just the one that's been picked
+    void setShowAll(bool showAll);
+    [[nodiscard]] bool isShowingAll() const { return m_showAll; }
+
+    void clear();
+
+    [[nodiscard]] Route* getRoute(uint64_t flightId) const;
+
+    // Returns the existing route if it's already loaded
+    Route* load(uint64_t flightId);
+
+    // Zero if nothing has been recorded recently
+    [[nodiscard]] uint64_t getLiveFlightId() const;
+
+    [[nodiscard]] size_t getLoaded() const { return m_routes.size(); }
+};
+
+#endif //BLACKBOX_ROUTEMANAGER_H
@@ -5,13 +5,21 @@
 #include "routemap.h"
 #include "route.h"
 
+#include <cmath>
+
+#include <QDir>
+#include <QStandardPaths>
 #include <QTimer>
 
-#include <QGeoView/QGVLayerOSM.h>
 #include <QGeoView/QGVWidgetText.h>
 
 #include "../blackbox.h"
-#include "landingicon.h"
+#include "eventmarkers.h"
+#include "heatmaplayer.h"
+#include "iconatlas.h"
+#include "routemanager.h"
+#include "tilelayer.h"
+#include "tileprefetcher.h"
 
 using namespace std;
 
@@ -20,9 +28,14 @@ RouteMap::RouteMap(BlackBoxUI* blackBoxUI) : m_blackBoxUI(blackBoxUI)
     setMouseAction(QGV::MouseAction::Tooltip, true);
     setMouseAction(QGV::MouseAction::ContextMenu, true);
 
-    // Background layer
-    auto backgroundLayer = new QGVLayerOSM();
-    m_backgroundLayer = backgroundLayer;
+    // Background layer, kept in an MBTiles file so flights can be looked at offline
+    auto cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(cacheDir);
+    m_tileStore.init((cacheDir + "/tiles.mbtiles").toStdString());
+
+    m_backgroundLayer = new TileLayer(&m_tileStore);
+    m_backgroundLayer->setUrl(m_blackBoxUI->getTileUrl());
+    m_prefetcher = new TilePrefetcher(m_backgroundLayer, this);
     //backgroundLayer->setUrl("https://services.arcgisonline.com/arcgis/rest/services/World_Imagery/MapServer/tile/${z}/${y}/${x}");
     //backgroundLayer->setUrl("https://services.arcgisonline.com/arcgis/rest/services/Canvas/World_Dark_Gray_Base/MapServer/tile/${z}/${y}/${x}");
     //backgroundLayer->setUrl("http://services.arcgisonline.com/ArcGIS/rest/services/Canvas/World_Dark_Gray_Base/MapServer/tile/${z}/${y}/${x}");
@@ -30,11 +43,24 @@ RouteMap::RouteMap(BlackBoxUI* blackBoxUI) : m_blackBoxUI(blackBoxUI)
     //backgroundLayer->setUrl("https://a.tile.opentopomap.org/${z}/${x}/${y}.png");
     addItem(m_backgroundLayer);
 
+    // Every flight at once, between the map and the routes
+    m_heatmapLayer = new HeatmapLayer(m_blackBoxUI, (cacheDir + "/density.grid").toStdString());
+    m_heatmapLayer->setShown(false);
+    addItem(m_heatmapLayer);
+
     m_itemsLayer = new QGVLayer();
     addItem(m_itemsLayer);
+    m_markers = new EventMarkers();
+    m_itemsLayer->addItem(m_markers);
+
+    m_cursorIcon = new QGVIcon();
+    m_cursorIcon->loadImage(IconAtlas::instance().getPlane(0));
+    m_cursorIcon->setVisible(false);
+    m_itemsLayer->addItem(m_cursorIcon);
 
     m_routesLayer = new QGVLayer();
     addItem(m_routesLayer);
+    m_routeManager = new RouteManager(this, m_routesLayer);
 
     auto copyrightWidget = new QGVWidgetText();
     copyrightWidget->setText("<small>© OpenStreetMap contributors</small>");
@@ -45,6 +71,9 @@ RouteMap::RouteMap(BlackBoxUI* blackBoxUI) : m_blackBoxUI(blackBoxUI)
 
 RouteMap::~RouteMap()
 {
+    // Both need the layers, which QGVMap deletes before our children are
+    delete m_routeManager;
+    delete m_prefetcher;
 }
 
 void RouteMap::setMode(MapMode mode)
@@ -56,56 +85,82 @@ void RouteMap::setMode(MapMode mode)
 
     m_mode = mode;
     clearRoutes();
-    if (m_mode == MapMode::ALL)
-    {
-        for (auto flight : m_blackBoxUI->getFlights())
-        {
-            Route* route = addRoute(flight.first);
-        }
-    }
-
+    m_routeManager->setShowAll(m_mode == MapMode::ALL);
+    m_heatmapLayer->setShown(m_mode == MapMode::HEATMAP);
 }
 
 void RouteMap::clearRoutes()
 {
-    for (auto route : m_routes)
-    {
-        route->removeFromMap();
-        m_routesLayer->removeItem(route);
-        delete route;
-    }
-    m_routes.clear();
+    // All at once rather than a flight at a time as the routes go
+    m_markers->clear();
+    m_routeManager->clear();
 }
 
-Route* RouteMap::addRoute(uint64_t flightId)
+void RouteMap::removeFlight(uint64_t flightId)
 {
-    Route* route = new Route(this, flightId);
-    route->updateRoute();
-    m_routesLayer->addItem(route);
-    m_routes.push_back(route);
-    return route;
+    m_heatmapLayer->removeFlight(flightId);
 }
 
 void RouteMap::showFlight(uint64_t flightId)
 {
-    for (auto route : m_routes)
+    Route* route = m_routeManager->getRoute(flightId);
+    if (route == nullptr)
     {
-        if (route->getFlight() == flightId)
+        if (!m_blackBoxUI->getFlights()->contains(flightId))
         {
-            route->showRoute();
             return;
         }
-    }
-
-    if (m_mode == MapMode::ROUTE)
-    {
-        clearRoutes();
-
-        auto it = m_blackBoxUI->getFlights().find(flightId);
-        if (it != m_blackBoxUI->getFlights().end())
+        // The heatmap shows the others, so just the one route on top of it
+        if (m_mode != MapMode::ALL)
         {
-            Route* route = addRoute(flightId);
-            route->showRoute();
+            clearRoutes();
         }
+        route = m_routeManager->load(flightId);
+        prefetchRoute(route);
     }
+
+    m_blackBoxUI->setState(route->getLastState());
+    route->showRoute();
+}
+
+void RouteMap::prefetchRoute(const Route* route)
+{
+    const auto& track = route->getTrack();
+    vector<double> latitudes(track.getLatitudes(), track.getLatitudes() + track.size());
+    vector<double> longitudes(track.getLongitudes(), track.getLongitudes() + track.size());
+    m_prefetcher->prefetchCorridor(latitudes.data(), longitudes.data(), track.size());
+}
+
+uint64_t RouteMap::getLiveFlightId() const
+{
+    return m_routeManager->getLiveFlightId();
+}
+
+void RouteMap::showCursor(const State& state)
+{
+    m_cursorIcon->loadImage(IconAtlas::instance().getPlane(state.yaw));
+    m_cursorIcon->setGeometry(QGV::GeoPos(state.position.latitude, state.position.longitude), QSizeF(40, 40));
+    m_cursorIcon->setVisible(true);
+    m_cursorIcon->bringToFront();
+}
+
+void RouteMap::hideCursor()
+{
+    m_cursorIcon->setVisible(false);
+}
+
+void RouteMap::prefetchAhead(const State& state)
+{
+    int zoom = m_backgroundLayer->getZoom(getCamera().scale());
+
+    // Enough to cover the view wherever the aircraft is in it
+    int margin = static_cast<int>(ceil(max(width(), height()) / 256.0 / 2.0));
+
+    m_prefetcher->prefetchAhead(
+        state.position.latitude,
+        state.position.longitude,
+        state.yaw,
+        state.groundSpeed,
+        zoom,
+        margin);
 }
@@ -10,17 +10,22 @@
 #include <QGeoView/Raster/QGVIcon.h>
 
 #include "blackbox/state.h"
+#include "tilestore.h"
 
-class QGVLayerTilesOnline;
-class QGVLayerTiles;
 class BlackBoxUI;
+class EventMarkers;
+class HeatmapLayer;
 class Route;
+class RouteManager;
+class TileLayer;
+class TilePrefetcher;
 
 
 enum class MapMode
 {
     ROUTE,
-    ALL
+    ALL,
+    HEATMAP
 };
 
 class RouteMap : public QGVMap
@@ -31,11 +36,18 @@ class RouteMap : public QGVMap
 
     MapMode m_mode = MapMode::ROUTE;
 
-    QGVLayerTilesOnline* m_backgroundLayer = nullptr;
+    TileStore m_tileStore;
+    TileLayer* m_backgroundLayer = nullptr;
+    TilePrefetcher* m_prefetcher = nullptr;
+    HeatmapLayer* m_heatmapLayer = nullptr;
     QGVLayer* m_itemsLayer = nullptr;
     QGVLayer* m_routesLayer = nullptr;
+    EventMarkers* m_markers = nullptr;
 
-    std::vector<Route*> m_routes;
+    RouteManager* m_routeManager = nullptr;
+
+    // Where the timeline is
+    QGVIcon* m_cursorIcon = nullptr;
 
 public:
     explicit RouteMap(BlackBoxUI* blackBoxUI);
@@ -45,12 +57,27 @@ public:
 
     void clearRoutes();
 
-    Route* addRoute(uint64_t flightId);
+    // Call before a flight is deleted, so it can be taken off the heatmap
+    void removeFlight(uint64_t flightId);
 
     void showFlight(uint64_t flightId);
 
+    // Downloads the map along the route for flying it again offline
+    void prefetchRoute(const Route* route);
+
+    // Zero if nothing's being recorded
+    [[nodiscard]] uint64_t getLiveFlightId() const;
+
+    // Shows where the aircraft was at a point in the flight
+    void showCursor(const State& state);
+    void hideCursor();
+
+    // Gets the map ready for where the live aircraft is going
+    void prefetchAhead(const State& state);
+
     BlackBoxUI* getBlackBoxUI() const { return m_blackBoxUI; }
     QGVLayer* getItemsLayer() const { return m_itemsLayer; }
+    EventMarkers* getMarkers() const { return m_markers; }
 };
 
 #endif //BLACKBOX_ROUTEMAP_H
@@ -0,0 +1,224 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "tilelayer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+
+#include <QGeoView/Raster/QGVImage.h>
+
+using namespace std;
+
+// 256 tiles of 256x256 is 64MB, about four screens full
+constexpr size_t IMAGE_CACHE_SIZE = 256;
+
+bool TileImageCache::get(const TileId& tile, QImage& image)
+{
+    auto it = m_index.find(tile);
+    if (it == m_index.end())
+    {
+        return false;
+    }
+    m_images.splice(m_images.begin(), m_images, it->second);
+    image = it->second->second;
+    return true;
+}
+
+void TileImageCache::put(const TileId& tile, const QImage& image)
+{
+    auto it = m_index.find(tile);
+    if (it != m_index.end())
+    {
+        it->second->second = image;
+        m_images.splice(m_images.begin(), m_images, it->second);
+        return;
+    }
+
+    m_images.emplace_front(tile, image);
+    m_index[tile] = m_images.begin();
+    if (m_images.size() > m_capacity)
+    {
+        m_index.erase(m_images.back().first);
+        m_images.pop_back();
+    }
+}
+
+static TileId toTileId(const QGV::GeoTilePos& tilePos)
+{
+    return TileId{tilePos.zoom(), tilePos.pos().x(), tilePos.pos().y()};
+}
+
+TileLayer::TileLayer(TileStore* store) : m_store(store), m_images(IMAGE_CACHE_SIZE)
+{
+    setName("Tiles");
+}
+
+TileLayer::~TileLayer()
+{
+    // Aborting calls back in to m_requests
+    auto requests = std::move(m_requests);
+    m_requests.clear();
+    for (auto& [tile, reply] : requests)
+    {
+        if (reply != nullptr)
+        {
+            reply->abort();
+        }
+    }
+}
+
+int TileLayer::minZoomlevel() const
+{
+    return 0;
+}
+
+int TileLayer::maxZoomlevel() const
+{
+    return 19;
+}
+
+int TileLayer::scaleToZoom(double scale) const
+{
+    // The same as QGVLayerOSM
+    const double scaleChange = 1 / scale;
+    return static_cast<int>((20.0 - log(scaleChange) * M_LOG2E) + 0.5);
+}
+
+int TileLayer::getZoom(double scale) const
+{
+    return clamp(scaleToZoom(scale), minZoomlevel(), maxZoomlevel());
+}
+
+bool TileLayer::warm(const TileId& tile)
+{
+    if (m_images.contains(tile))
+    {
+        return true;
+    }
+
+    vector<char> data;
+    if (!m_store->fetchTile(tile, data))
+    {
+        return false;
+    }
+    cacheTile(tile, QByteArray(data.data(), static_cast<qsizetype>(data.size())));
+    return true;
+}
+
+void TileLayer::cacheTile(const TileId& tile, const QByteArray& data)
+{
+    QImage image;
+    if (image.loadFromData(data))
+    {
+        m_images.put(tile, image);
+    }
+}
+
+QString TileLayer::getTileUrl(const TileId& tile) const
+{
+    QString url = m_url;
+    url.replace("${z}", QString::number(tile.zoom));
+    url.replace("${x}", QString::number(tile.x));
+    url.replace("${y}", QString::number(tile.y));
+    return url;
+}
+
+void TileLayer::request(const QGV::GeoTilePos& tilePos)
+{
+    TileId tile = toTileId(tilePos);
+
+    // QGV doesn't expect the tile before request() returns
+    QImage image;
+    if (m_images.get(tile, image) || (warm(tile) && m_images.get(tile, image)))
+    {
+        m_requests[tile] = nullptr;
+        QTimer::singleShot(0, this, [this, tile, image]() { deliver(tile, image); });
+        return;
+    }
+
+    m_requests[tile] = download(tile, [this, tile](bool success, const QByteArray& bytes)
+    {
+        QImage image;
+        if (success && image.loadFromData(bytes))
+        {
+            m_images.put(tile, image);
+            deliver(tile, image);
+        }
+        else
+        {
+            m_requests.erase(tile);
+        }
+    });
+}
+
+void TileLayer::cancel(const QGV::GeoTilePos& tilePos)
+{
+    auto it = m_requests.find(toTileId(tilePos));
+    if (it == m_requests.end())
+    {
+        return;
+    }
+    QNetworkReply* reply = it->second;
+    m_requests.erase(it);
+    if (reply != nullptr)
+    {
+        reply->abort();
+    }
+}
+
+void TileLayer::deliver(const TileId& tile, const QImage& image)
+{
+    // It may have been cancelled while we were waiting
+    if (m_requests.erase(tile) == 0)
+    {
+        return;
+    }
+
+    QGV::GeoTilePos tilePos(tile.zoom, QPoint(tile.x, tile.y));
+    auto item = new QGVImage();
+    item->setGeometry(tilePos.toGeoRect());
+    item->loadImage(image);
+    onTile(tilePos, item);
+}
+
+QNetworkReply* TileLayer::download(const TileId& tile, const function<void(bool success, const QByteArray& data)>& done)
+{
+    QNetworkRequest request(QUrl(getTileUrl(tile)));
+    request.setRawHeader("User-Agent", "BlackBox Flight Tracker");
+    request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+
+    QNetworkReply* reply = QGV::getNetworkManager()->get(request);
+    connect(reply, &QNetworkReply::finished, this, [this, tile, reply, done]()
+    {
+        reply->deleteLater();
+
+        bool success = reply->error() == QNetworkReply::NoError;
+        QByteArray data;
+        if (success)
+        {
+            data = reply->readAll();
+            success = !data.isEmpty();
+        }
+        if (success)
+        {
+            m_store->writeTile(tile, data.constData(), data.size());
+        }
+        else if (reply->error() != QNetworkReply::OperationCanceledError)
+        {
+            printf(
+                "TileLayer: Failed to download tile %d/%d/%d: %s\n",
+                tile.zoom,
+                tile.x,
+                tile.y,
+                reply->errorString().toStdString().c_str());
+        }
+        done(success, data);
+    });
+    return reply;
+}
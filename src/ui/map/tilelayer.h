@@ -0,0 +1,80 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_TILELAYER_H
+#define BLACKBOX_TILELAYER_H
+
+#include <functional>
+#include <list>
+#include <map>
+
+#include <QImage>
+#include <QGeoView/QGVLayerTiles.h>
+
+#include "tilestore.h"
+
+class QNetworkReply;
+
+// The most recently used tiles, already decoded
+class TileImageCache
+{
+    size_t m_capacity;
+    std::list<std::pair<TileId, QImage>> m_images;
+    std::map<TileId, std::list<std::pair<TileId, QImage>>::iterator> m_index;
+
+ public:
+    explicit TileImageCache(size_t capacity) : m_capacity(capacity) {}
+
+    bool get(const TileId& tile, QImage& image);
+    [[nodiscard]] bool contains(const TileId& tile) const { return m_index.contains(tile); }
+    void put(const TileId& tile, const QImage& image);
+
+    [[nodiscard]] size_t size() const { return m_images.size(); }
+};
+
+// Background tiles from the MBTiles store, only going to the tile server for ones it doesn't have
+class TileLayer : public QGVLayerTiles
+{
+    Q_OBJECT
+
+    TileStore* m_store;
+    QString m_url;
+
+    // Tiles QGV still wants, and the download if they weren't in the store
+    std::map<TileId, QNetworkReply*> m_requests;
+
+    TileImageCache m_images;
+
+    void deliver(const TileId& tile, const QImage& image);
+
+ protected:
+    int minZoomlevel() const override;
+    int maxZoomlevel() const override;
+    int scaleToZoom(double scale) const override;
+    void request(const QGV::GeoTilePos& tilePos) override;
+    void cancel(const QGV::GeoTilePos& tilePos) override;
+
+ public:
+    explicit TileLayer(TileStore* store);
+    ~TileLayer() override;
+
+    // With ${z}, ${x} and ${y} for the tile
+    void setUrl(const QString& url) { m_url = url; }
+    [[nodiscard]] const QString& getUrl() const { return m_url; }
+    [[nodiscard]] QString getTileUrl(const TileId& tile) const;
+
+    TileStore* getStore() const { return m_store; }
+
+    // Zoom level the layer would show at the camera's scale
+    [[nodiscard]] int getZoom(double scale) const;
+
+    // Decodes a stored tile ready for when it's needed. Returns false if it isn't stored.
+    bool warm(const TileId& tile);
+    void cacheTile(const TileId& tile, const QByteArray& data);
+
+    // Downloads a tile and adds it to the store. The reply has been finished with by the time done is called.
+    QNetworkReply* download(const TileId& tile, const std::function<void(bool success, const QByteArray& data)>& done);
+};
+
+#endif //BLACKBOX_TILELAYER_H
@@ -0,0 +1,271 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "tileprefetcher.h"
+#include "tilelayer.h"
+
+#include "blackbox/geo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <QNetworkReply>
+
+using namespace std;
+
+TilePrefetcher::TilePrefetcher(TileLayer* layer, QObject* parent) : QObject(parent), m_layer(layer)
+{
+}
+
+TilePrefetcher::~TilePrefetcher()
+{
+    clear();
+}
+
+// Position in tiles at the given zoom level, not rounded down
+static void toTileSpace(int zoom, double latitude, double longitude, double& x, double& y)
+{
+    latitude = clamp(latitude, -85.0511, 85.0511);
+    const double tiles = 1 << zoom;
+    x = (longitude + 180.0) / 360.0 * tiles;
+    y = (1.0 - asinh(tan(latitude * M_PI / 180.0)) / M_PI) / 2.0 * tiles;
+}
+
+set<TileId> TilePrefetcher::corridorTiles(
+    const double* latitudes,
+    const double* longitudes,
+    size_t count,
+    int minZoom,
+    int maxZoom,
+    int margin)
+{
+    set<TileId> tiles;
+    for (int zoom = minZoom; zoom <= maxZoom; zoom++)
+    {
+        const int size = 1 << zoom;
+        TileId last{-1, 0, 0};
+
+        auto addTile = [&](double x, double y)
+        {
+            TileId centre{zoom, static_cast<int>(floor(x)), clamp(static_cast<int>(floor(y)), 0, size - 1)};
+            centre.x = ((centre.x % size) + size) % size;
+            if (centre == last)
+            {
+                return;
+            }
+            last = centre;
+
+            for (int dy = -margin; dy <= margin; dy++)
+            {
+                int y1 = centre.y + dy;
+                if (y1 < 0 || y1 >= size)
+                {
+                    continue;
+                }
+                for (int dx = -margin; dx <= margin; dx++)
+                {
+                    tiles.insert(TileId{zoom, ((centre.x + dx) % size + size) % size, y1});
+                }
+            }
+        };
+
+        double previousX = 0.0;
+        double previousY = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            double x;
+            double y;
+            toTileSpace(zoom, latitudes[i], longitudes[i], x, y);
+            if (i == 0)
+            {
+                addTile(x, y);
+            }
+            else
+            {
+                // Take the short way round over the anti-meridian
+                if (x - previousX > size / 2.0)
+                {
+                    x -= size;
+                }
+                else if (previousX - x > size / 2.0)
+                {
+                    x += size;
+                }
+
+                // Points can be further apart than a tile, so walk along the gap in half tile steps
+                int steps = max(1, static_cast<int>(ceil(max(abs(x - previousX), abs(y - previousY)) * 2.0)));
+                for (int step = 1; step <= steps; step++)
+                {
+                    double t = static_cast<double>(step) / steps;
+                    addTile(previousX + (x - previousX) * t, previousY + (y - previousY) * t);
+                }
+            }
+            previousX = x;
+            previousY = y;
+        }
+    }
+    return tiles;
+}
+
+size_t TilePrefetcher::prefetchCorridor(
+    const double* latitudes,
+    const double* longitudes,
+    size_t count,
+    int minZoom,
+    int maxZoom)
+{
+    TileStore* store = m_layer->getStore();
+    size_t queued = 0;
+    for (const TileId& tile : corridorTiles(latitudes, longitudes, count, minZoom, maxZoom))
+    {
+        if (m_wanted.contains(tile) || store->hasTile(tile))
+        {
+            continue;
+        }
+        m_wanted.insert(tile);
+        m_queue.push_back(tile);
+        queued++;
+    }
+
+    if (queued > 0)
+    {
+        printf("TilePrefetcher: Queued %zu tiles for zoom levels %d-%d\n", queued, minZoom, maxZoom);
+    }
+    startDownloads();
+    return queued;
+}
+
+size_t TilePrefetcher::prefetchAhead(
+    double latitude,
+    double longitude,
+    float heading,
+    float groundSpeed,
+    int zoom,
+    int margin,
+    double lookahead)
+{
+    UFC::Coordinate position;
+    position.latitude = latitude;
+    position.longitude = longitude;
+    double distance = groundSpeed / KM_TO_NM * lookahead / 3600.0;
+    UFC::Coordinate ahead = ::destination(position, heading, distance);
+
+    // Anything we can't get in time isn't worth starting
+    m_aheadQueue.clear();
+
+    vector<pair<double, TileId>> missing;
+    const double latitudes[] = {position.latitude, ahead.latitude};
+    const double longitudes[] = {position.longitude, ahead.longitude};
+    for (int level = max(0, zoom - 1); level <= zoom; level++)
+    {
+        double x;
+        double y;
+        toTileSpace(level, latitude, longitude, x, y);
+        const int size = 1 << level;
+        for (const TileId& tile : corridorTiles(latitudes, longitudes, 2, level, level, margin))
+        {
+            if (m_layer->warm(tile) || m_wanted.contains(tile))
+            {
+                continue;
+            }
+
+            // Nearest first, in tiles at the level we're showing
+            double dx = abs(tile.x + 0.5 - x);
+            dx = min(dx, size - dx);
+            double dy = tile.y + 0.5 - y;
+            double scale = 1 << (zoom - level);
+            missing.emplace_back(sqrt(dx * dx + dy * dy) * scale, tile);
+        }
+    }
+
+    sort(missing.begin(), missing.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 0; i < missing.size() && i < MAX_AHEAD; i++)
+    {
+        m_aheadQueue.push_back(missing[i].second);
+    }
+
+    startDownloads();
+    return m_aheadQueue.size();
+}
+
+void TilePrefetcher::clear()
+{
+    m_queue.clear();
+    m_aheadQueue.clear();
+
+    // Aborting calls back in to m_downloads
+    auto downloads = std::move(m_downloads);
+    m_downloads.clear();
+    for (QNetworkReply* reply : downloads)
+    {
+        reply->abort();
+    }
+    m_wanted.clear();
+}
+
+void TilePrefetcher::startDownloads()
+{
+    while (m_downloads.size() < MAX_DOWNLOADS && !m_aheadQueue.empty())
+    {
+        TileId tile = m_aheadQueue.front();
+        m_aheadQueue.pop_front();
+        if (!m_wanted.contains(tile))
+        {
+            m_wanted.insert(tile);
+            download(tile, true);
+        }
+    }
+
+    while (m_downloads.size() < MAX_DOWNLOADS && !m_queue.empty())
+    {
+        TileId tile = m_queue.front();
+        m_queue.pop_front();
+
+        // The map may have wanted it while it was queued
+        if (m_layer->getStore()->hasTile(tile))
+        {
+            m_wanted.erase(tile);
+            continue;
+        }
+        download(tile, false);
+    }
+}
+
+void TilePrefetcher::download(const TileId& tile, bool ahead)
+{
+    // Set once download() returns, the reply can't finish before we're back in the event loop
+    auto reply = make_shared<QNetworkReply*>(nullptr);
+    *reply = m_layer->download(tile, [this, tile, ahead, reply](bool success, const QByteArray& data)
+    {
+        if (m_downloads.erase(*reply) == 0)
+        {
+            // Cancelled
+            return;
+        }
+        m_wanted.erase(tile);
+        if (success)
+        {
+            m_fetched++;
+            if (ahead)
+            {
+                // It'll be on screen soon
+                m_layer->cacheTile(tile, data);
+            }
+        }
+        else
+        {
+            m_failed++;
+        }
+
+        startDownloads();
+        if (m_downloads.empty() && m_queue.empty() && m_aheadQueue.empty())
+        {
+            printf("TilePrefetcher: Finished, %zu tiles fetched, %zu failed\n", m_fetched, m_failed);
+            emit finished();
+        }
+    });
+    m_downloads.insert(*reply);
+}
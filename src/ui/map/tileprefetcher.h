@@ -0,0 +1,88 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_TILEPREFETCHER_H
+#define BLACKBOX_TILEPREFETCHER_H
+
+#include <deque>
+#include <set>
+
+#include <QObject>
+
+#include "tilestore.h"
+
+class TileLayer;
+class QNetworkReply;
+
+// Downloads tiles in the background so they're already in the store when the map wants them
+class TilePrefetcher : public QObject
+{
+    Q_OBJECT
+
+    TileLayer* m_layer;
+
+    std::deque<TileId> m_queue;
+    // Ahead of the aircraft, replaced on every update and downloaded before anything else
+    std::deque<TileId> m_aheadQueue;
+    // Queued or downloading, so nothing is fetched twice
+    std::set<TileId> m_wanted;
+    std::set<QNetworkReply*> m_downloads;
+
+    size_t m_fetched = 0;
+    size_t m_failed = 0;
+
+    void startDownloads();
+    void download(const TileId& tile, bool ahead);
+
+ public:
+    // Be kind to the tile server
+    static constexpr size_t MAX_DOWNLOADS = 4;
+
+    // Beyond this, the aircraft will have moved on before they're downloaded
+    static constexpr size_t MAX_AHEAD = 64;
+
+    explicit TilePrefetcher(TileLayer* layer, QObject* parent = nullptr);
+    ~TilePrefetcher() override;
+
+    // Every tile within margin tiles of the track for each zoom level. Latitudes and
+    // longitudes are in degrees.
+    static std::set<TileId> corridorTiles(
+        const double* latitudes,
+        const double* longitudes,
+        size_t count,
+        int minZoom,
+        int maxZoom,
+        int margin = 1);
+
+    // Queues anything along the track that isn't already stored. Returns how many were queued.
+    size_t prefetchCorridor(
+        const double* latitudes,
+        const double* longitudes,
+        size_t count,
+        int minZoom = 0,
+        int maxZoom = 12);
+
+    // Gets the tiles along the next lookahead seconds of the aircraft's path ready, at zoom and the
+    // level above. margin is how many tiles either side the view covers. Stored tiles are decoded
+    // straight away and the nearest missing ones are downloaded first.
+    size_t prefetchAhead(
+        double latitude,
+        double longitude,
+        float heading,
+        float groundSpeed,
+        int zoom,
+        int margin,
+        double lookahead = 120.0);
+
+    void clear();
+
+    [[nodiscard]] size_t getQueued() const { return m_queue.size() + m_aheadQueue.size() + m_downloads.size(); }
+    [[nodiscard]] size_t getFetched() const { return m_fetched; }
+    [[nodiscard]] size_t getFailed() const { return m_failed; }
+
+ signals:
+    void finished();
+};
+
+#endif //BLACKBOX_TILEPREFETCHER_H
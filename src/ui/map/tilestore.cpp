@@ -0,0 +1,195 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "tilestore.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace BlackBox;
+
+TileId TileId::fromGeo(int zoom, double latitude, double longitude)
+{
+    // Web Mercator stops short of the poles
+    latitude = clamp(latitude, -85.0511, 85.0511);
+
+    const int tiles = 1 << zoom;
+    const double latRad = latitude * M_PI / 180.0;
+    const double x = (longitude + 180.0) / 360.0 * tiles;
+    const double y = (1.0 - asinh(tan(latRad)) / M_PI) / 2.0 * tiles;
+
+    TileId tile;
+    tile.zoom = zoom;
+    tile.x = clamp(static_cast<int>(floor(x)), 0, tiles - 1);
+    tile.y = clamp(static_cast<int>(floor(y)), 0, tiles - 1);
+    return tile;
+}
+
+// MBTiles rows count up from the bottom
+static int toTMSRow(const TileId& tile)
+{
+    return (1 << tile.zoom) - 1 - tile.y;
+}
+
+TileStore::TileStore() : Logger("TileStore")
+{
+}
+
+TileStore::~TileStore()
+{
+    if (m_fetchTileStatement != nullptr)
+    {
+        sqlite3_finalize(m_fetchTileStatement);
+    }
+    if (m_hasTileStatement != nullptr)
+    {
+        sqlite3_finalize(m_hasTileStatement);
+    }
+    if (m_writeTileStatement != nullptr)
+    {
+        sqlite3_finalize(m_writeTileStatement);
+    }
+    if (m_db != nullptr)
+    {
+        sqlite3_close(m_db);
+    }
+}
+
+bool TileStore::init(const string& path)
+{
+    int res = sqlite3_open(path.c_str(), &m_db);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "init: Failed to open %s: %s", path.c_str(), sqlite3_errmsg(m_db));
+        sqlite3_close(m_db);
+        m_db = nullptr;
+        return false;
+    }
+
+    // Tiles can always be downloaded again, so don't wait for the disk after every one
+    const char* sql =
+        "PRAGMA journal_mode=WAL;"
+        "PRAGMA synchronous=NORMAL;"
+        "CREATE TABLE IF NOT EXISTS metadata (name TEXT, value TEXT);"
+        "CREATE UNIQUE INDEX IF NOT EXISTS metadata_name ON metadata (name);"
+        "CREATE TABLE IF NOT EXISTS tiles ("
+        "    zoom_level INTEGER,"
+        "    tile_column INTEGER,"
+        "    tile_row INTEGER,"
+        "    tile_data BLOB"
+        ");"
+        "CREATE UNIQUE INDEX IF NOT EXISTS tile_index ON tiles (zoom_level, tile_column, tile_row);"
+        "INSERT OR IGNORE INTO metadata (name, value) VALUES"
+        "    ('name', 'BlackBox'),"
+        "    ('format', 'png'),"
+        "    ('type', 'baselayer'),"
+        "    ('version', '1');";
+    char* err;
+    res = sqlite3_exec(m_db, sql, nullptr, nullptr, &err);
+    if (res != SQLITE_OK)
+    {
+        log(ERROR, "init: Failed to create tables: %s", err);
+        sqlite3_free(err);
+        sqlite3_close(m_db);
+        m_db = nullptr;
+        return false;
+    }
+
+    log(INFO, "init: Using tiles from %s", path.c_str());
+    return true;
+}
+
+sqlite3_stmt* TileStore::prepare(sqlite3_stmt*& stmt, const char* sql)
+{
+    if (stmt == nullptr)
+    {
+        int res = sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr);
+        if (res != SQLITE_OK)
+        {
+            log(ERROR, "prepare: Failed to prepare statement: %d: %s", res, sqlite3_errmsg(m_db));
+            return nullptr;
+        }
+    }
+    return stmt;
+}
+
+bool TileStore::fetchTile(const TileId& tile, vector<char>& data)
+{
+    if (m_db == nullptr)
+    {
+        return false;
+    }
+    sqlite3_stmt* stmt = prepare(
+        m_fetchTileStatement,
+        "SELECT tile_data FROM tiles WHERE zoom_level=? AND tile_column=? AND tile_row=?");
+    if (stmt == nullptr)
+    {
+        return false;
+    }
+
+    sqlite3_bind_int(stmt, 1, tile.zoom);
+    sqlite3_bind_int(stmt, 2, tile.x);
+    sqlite3_bind_int(stmt, 3, toTMSRow(tile));
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        auto blob = static_cast<const char*>(sqlite3_column_blob(stmt, 0));
+        int length = sqlite3_column_bytes(stmt, 0);
+        data.assign(blob, blob + length);
+        found = length > 0;
+    }
+    sqlite3_reset(stmt);
+    return found;
+}
+
+bool TileStore::hasTile(const TileId& tile)
+{
+    if (m_db == nullptr)
+    {
+        return false;
+    }
+    sqlite3_stmt* stmt = prepare(
+        m_hasTileStatement,
+        "SELECT 1 FROM tiles WHERE zoom_level=? AND tile_column=? AND tile_row=?");
+    if (stmt == nullptr)
+    {
+        return false;
+    }
+
+    sqlite3_bind_int(stmt, 1, tile.zoom);
+    sqlite3_bind_int(stmt, 2, tile.x);
+    sqlite3_bind_int(stmt, 3, toTMSRow(tile));
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_reset(stmt);
+    return found;
+}
+
+int TileStore::writeTile(const TileId& tile, const char* data, size_t length)
+{
+    if (m_db == nullptr)
+    {
+        return SQLITE_MISUSE;
+    }
+    sqlite3_stmt* stmt = prepare(
+        m_writeTileStatement,
+        "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)");
+    if (stmt == nullptr)
+    {
+        return SQLITE_ERROR;
+    }
+
+    sqlite3_bind_int(stmt, 1, tile.zoom);
+    sqlite3_bind_int(stmt, 2, tile.x);
+    sqlite3_bind_int(stmt, 3, toTMSRow(tile));
+    sqlite3_bind_blob(stmt, 4, data, static_cast<int>(length), SQLITE_STATIC);
+    int res = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (res != SQLITE_DONE)
+    {
+        log(ERROR, "writeTile: Failed to write tile %d/%d/%d: %d: %s", tile.zoom, tile.x, tile.y, res, sqlite3_errmsg(m_db));
+        return res;
+    }
+    return SQLITE_OK;
+}
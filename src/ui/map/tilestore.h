@@ -0,0 +1,66 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_TILESTORE_H
+#define BLACKBOX_TILESTORE_H
+
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "blackbox/logger.h"
+
+// A slippy map tile. y counts down from the top like the tile servers, not up like MBTiles does.
+struct TileId
+{
+    int zoom = 0;
+    int x = 0;
+    int y = 0;
+
+    // The tile at zoom containing the position
+    static TileId fromGeo(int zoom, double latitude, double longitude);
+
+    bool operator<(const TileId& other) const
+    {
+        if (zoom != other.zoom)
+        {
+            return zoom < other.zoom;
+        }
+        if (x != other.x)
+        {
+            return x < other.x;
+        }
+        return y < other.y;
+    }
+
+    bool operator==(const TileId& other) const
+    {
+        return zoom == other.zoom && x == other.x && y == other.y;
+    }
+};
+
+// Map tiles kept in an MBTiles file so the map works offline
+class TileStore : BlackBox::Logger
+{
+    sqlite3* m_db = nullptr;
+    sqlite3_stmt* m_fetchTileStatement = nullptr;
+    sqlite3_stmt* m_hasTileStatement = nullptr;
+    sqlite3_stmt* m_writeTileStatement = nullptr;
+
+    sqlite3_stmt* prepare(sqlite3_stmt*& stmt, const char* sql);
+
+ public:
+    TileStore();
+    ~TileStore() override;
+
+    bool init(const std::string& path);
+    [[nodiscard]] bool isOpen() const { return m_db != nullptr; }
+
+    bool fetchTile(const TileId& tile, std::vector<char>& data);
+    bool hasTile(const TileId& tile);
+    int writeTile(const TileId& tile, const char* data, size_t length);
+};
+
+#endif //BLACKBOX_TILESTORE_H
@@ -0,0 +1,451 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "profilechart.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <QWheelEvent>
+
+#include "blackbox/datastore.h"
+
+using namespace std;
+
+constexpr int LEFT_MARGIN = 60;
+constexpr int RIGHT_MARGIN = 10;
+constexpr int BOTTOM_MARGIN = 20;
+constexpr int TICKS = 5;
+
+constexpr size_t CACHE_SIZE = 8;
+constexpr uint64_t MIN_SPAN_MS = 10 * 1000;
+constexpr double ZOOM_STEP = 0.8;
+
+static QString formatTime(uint64_t ms)
+{
+    uint64_t minutes = ms / 60000;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%" PRIu64 ":%02" PRIu64, minutes / 60, minutes % 60);
+    return buf;
+}
+
+ProfileChart::ProfileChart(string dbPath, QWidget* parent) : QWidget(parent), m_dbPath(std::move(dbPath))
+{
+    setMinimumHeight(160);
+    setMouseTracking(false);
+
+    m_seriesComboBox = new QComboBox(this);
+    for (int i = 0; i < PROFILE_SERIES_COUNT; i++)
+    {
+        m_seriesComboBox->addItem(getProfileSeriesName(static_cast<ProfileSeries>(i)), i);
+    }
+    m_seriesComboBox->move(LEFT_MARGIN, 0);
+    connect(m_seriesComboBox, &QComboBox::currentIndexChanged, this, [this](int index)
+    {
+        setSeries(static_cast<ProfileSeries>(m_seriesComboBox->itemData(index).toInt()));
+    });
+
+    m_worker = thread([this]() { work(); });
+}
+
+ProfileChart::~ProfileChart()
+{
+    {
+        lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_signal.notify_one();
+    m_worker.join();
+}
+
+void ProfileChart::work()
+{
+    DataStore dataStore;
+    bool open = false;
+
+    while (true)
+    {
+        unique_lock lock(m_mutex);
+        m_signal.wait(lock, [this]() { return m_stopping || m_loadFlightId != 0 || m_hasRequest; });
+        if (m_stopping)
+        {
+            break;
+        }
+
+        if (m_loadFlightId != 0)
+        {
+            uint64_t flightId = m_loadFlightId;
+            m_loadFlightId = 0;
+            lock.unlock();
+
+            if (!open)
+            {
+                open = dataStore.init(m_dbPath);
+            }
+            auto profile = make_shared<Profile>();
+            if (open)
+            {
+                dataStore.fetchProfile(flightId, *profile);
+            }
+            shared_ptr<const Profile> loaded = profile;
+            QMetaObject::invokeMethod(this, [this, flightId, loaded]() { profileLoaded(flightId, loaded); });
+            continue;
+        }
+
+        View view = m_request;
+        shared_ptr<const Profile> profile = std::move(m_requestProfile);
+        m_hasRequest = false;
+        lock.unlock();
+
+        auto result = make_shared<Decimated>();
+        result->view = view;
+        result->minimums.resize(view.buckets);
+        result->maximums.resize(view.buckets);
+        profile->decimate(
+            view.series,
+            view.start,
+            view.end,
+            view.buckets,
+            result->minimums.data(),
+            result->maximums.data());
+
+        shared_ptr<const Decimated> decimated = result;
+        QMetaObject::invokeMethod(this, [this, decimated]() { this->decimated(decimated); });
+    }
+}
+
+void ProfileChart::setFlight(uint64_t flightId)
+{
+    if (flightId == m_flightId)
+    {
+        return;
+    }
+    m_flightId = flightId;
+    m_profile = nullptr;
+    m_shown = nullptr;
+    m_cache.clear();
+    m_cursor = 0;
+    update();
+
+    if (flightId == 0)
+    {
+        return;
+    }
+
+    {
+        lock_guard lock(m_mutex);
+        m_loadFlightId = flightId;
+        m_hasRequest = false;
+        m_requestProfile = nullptr;
+    }
+    m_signal.notify_one();
+}
+
+void ProfileChart::setSeries(ProfileSeries series)
+{
+    if (series == m_series)
+    {
+        return;
+    }
+    m_series = series;
+    m_shown = nullptr;
+    requestView();
+    update();
+}
+
+void ProfileChart::setCursor(uint64_t timestamp)
+{
+    m_cursor = timestamp;
+    update();
+}
+
+void ProfileChart::profileLoaded(uint64_t flightId, const shared_ptr<const Profile>& profile)
+{
+    if (flightId != m_flightId)
+    {
+        // Something else has been picked since
+        return;
+    }
+
+    m_profile = profile;
+    if (!profile->empty())
+    {
+        m_viewStart = profile->timestamps.front();
+        m_viewEnd = profile->timestamps.back();
+    }
+    requestView();
+}
+
+void ProfileChart::requestView()
+{
+    QRect plot = plotRect();
+    if (m_profile == nullptr || m_profile->empty() || plot.width() <= 0)
+    {
+        return;
+    }
+
+    View view;
+    view.flightId = m_flightId;
+    view.series = m_series;
+    view.start = m_viewStart;
+    view.end = m_viewEnd;
+    view.buckets = plot.width();
+
+    for (auto it = m_cache.begin(); it != m_cache.end(); it++)
+    {
+        if ((*it)->view == view)
+        {
+            m_shown = *it;
+            m_cache.splice(m_cache.begin(), m_cache, it);
+            update();
+            return;
+        }
+    }
+
+    {
+        lock_guard lock(m_mutex);
+        m_request = view;
+        m_requestProfile = m_profile;
+        m_hasRequest = true;
+    }
+    m_signal.notify_one();
+}
+
+void ProfileChart::decimated(const shared_ptr<const Decimated>& decimated)
+{
+    if (decimated->view.flightId != m_flightId || decimated->view.series != m_series)
+    {
+        return;
+    }
+
+    m_cache.push_front(decimated);
+    if (m_cache.size() > CACHE_SIZE)
+    {
+        m_cache.pop_back();
+    }
+
+    // Even if the view has moved on since, it's closer than what's there
+    m_shown = decimated;
+    update();
+}
+
+QRect ProfileChart::plotRect() const
+{
+    int top = m_seriesComboBox->sizeHint().height() + 4;
+    return {LEFT_MARGIN, top, width() - LEFT_MARGIN - RIGHT_MARGIN, height() - top - BOTTOM_MARGIN};
+}
+
+uint64_t ProfileChart::xToTime(int x) const
+{
+    QRect plot = plotRect();
+    double f = clamp(static_cast<double>(x - plot.left()) / plot.width(), 0.0, 1.0);
+    return m_viewStart + static_cast<uint64_t>(f * static_cast<double>(m_viewEnd - m_viewStart));
+}
+
+double ProfileChart::timeToX(uint64_t t) const
+{
+    QRect plot = plotRect();
+    double f = (static_cast<double>(t) - static_cast<double>(m_viewStart)) / static_cast<double>(m_viewEnd - m_viewStart);
+    return plot.left() + f * plot.width();
+}
+
+void ProfileChart::paintEvent(QPaintEvent* event)
+{
+    QWidget::paintEvent(event);
+
+    QPainter p(this);
+    QRect plot = plotRect();
+    p.fillRect(plot, palette().base());
+    p.setPen(palette().mid().color());
+    p.drawRect(plot);
+
+    if (m_shown == nullptr || m_profile == nullptr || m_viewEnd <= m_viewStart)
+    {
+        return;
+    }
+
+    // Scale to what can actually be seen
+    const Decimated& shown = *m_shown;
+    const double bucketMs = static_cast<double>(shown.view.end - shown.view.start) / shown.view.buckets;
+    float lo = INFINITY;
+    float hi = -INFINITY;
+    for (int i = 0; i < shown.view.buckets; i++)
+    {
+        auto t = static_cast<uint64_t>(static_cast<double>(shown.view.start) + (i + 0.5) * bucketMs);
+        if (t < m_viewStart || t > m_viewEnd || isnan(shown.minimums[i]))
+        {
+            continue;
+        }
+        lo = min(lo, shown.minimums[i]);
+        hi = max(hi, shown.maximums[i]);
+    }
+    if (lo > hi)
+    {
+        return;
+    }
+    if (hi - lo < 1.0f)
+    {
+        hi += 0.5f;
+        lo -= 0.5f;
+    }
+    float pad = (hi - lo) * 0.05f;
+    lo -= pad;
+    hi += pad;
+
+    auto valueToY = [&plot, lo, hi](float v)
+    {
+        return plot.bottom() - static_cast<double>(v - lo) / (hi - lo) * plot.height();
+    };
+
+    // Axes
+    p.setPen(palette().text().color());
+    for (int i = 0; i <= TICKS; i++)
+    {
+        float v = lo + (hi - lo) * i / TICKS;
+        int y = static_cast<int>(valueToY(v));
+        p.drawText(QRect(0, y - 10, LEFT_MARGIN - 4, 20), Qt::AlignRight | Qt::AlignVCenter, QString::number(v, 'f', 0));
+
+        uint64_t t = m_viewStart + (m_viewEnd - m_viewStart) * i / TICKS;
+        int x = static_cast<int>(timeToX(t));
+        p.drawText(QRect(x - 30, plot.bottom() + 2, 60, BOTTOM_MARGIN - 2), Qt::AlignCenter, formatTime(t - m_profile->timestamps.front()));
+    }
+
+    // Each column goes from its lowest to its highest, so nothing in between is lost
+    QPainterPath path;
+    bool first = true;
+    for (int i = 0; i < shown.view.buckets; i++)
+    {
+        if (isnan(shown.minimums[i]))
+        {
+            continue;
+        }
+        auto t = static_cast<uint64_t>(static_cast<double>(shown.view.start) + (i + 0.5) * bucketMs);
+        double x = timeToX(t);
+        if (first)
+        {
+            path.moveTo(x, valueToY(shown.minimums[i]));
+            first = false;
+        }
+        else
+        {
+            path.lineTo(x, valueToY(shown.minimums[i]));
+        }
+        path.lineTo(x, valueToY(shown.maximums[i]));
+    }
+
+    p.setClipRect(plot);
+    p.setRenderHint(QPainter::Antialiasing);
+    p.setPen(QPen(palette().highlight().color(), 1.5));
+    p.drawPath(path);
+
+    if (m_cursor >= m_viewStart && m_cursor <= m_viewEnd)
+    {
+        double x = timeToX(m_cursor);
+        p.setPen(QPen(Qt::red, 1));
+        p.drawLine(QPointF(x, plot.top()), QPointF(x, plot.bottom()));
+    }
+}
+
+void ProfileChart::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    requestView();
+}
+
+void ProfileChart::wheelEvent(QWheelEvent* event)
+{
+    if (m_profile == nullptr || m_profile->empty())
+    {
+        return;
+    }
+
+    // Keep the time under the mouse where it is
+    uint64_t first = m_profile->timestamps.front();
+    uint64_t last = m_profile->timestamps.back();
+    if (last - first <= MIN_SPAN_MS)
+    {
+        return;
+    }
+    uint64_t anchor = xToTime(static_cast<int>(event->position().x()));
+    double scale = pow(ZOOM_STEP, event->angleDelta().y() / 120.0);
+
+    auto span = static_cast<double>(m_viewEnd - m_viewStart);
+    double newSpan = clamp(span * scale, static_cast<double>(MIN_SPAN_MS), static_cast<double>(last - first));
+    double f = (static_cast<double>(anchor) - static_cast<double>(m_viewStart)) / span;
+
+    double start = clamp(static_cast<double>(anchor) - f * newSpan, static_cast<double>(first), static_cast<double>(last) - newSpan);
+    m_viewStart = static_cast<uint64_t>(start);
+    m_viewEnd = m_viewStart + static_cast<uint64_t>(newSpan);
+
+    requestView();
+    update();
+    event->accept();
+}
+
+void ProfileChart::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton && plotRect().contains(event->pos()))
+    {
+        m_dragX = event->pos().x();
+        m_dragStart = m_viewStart;
+        m_dragged = false;
+    }
+}
+
+void ProfileChart::mouseMoveEvent(QMouseEvent* event)
+{
+    if (m_dragX < 0 || m_profile == nullptr || m_profile->empty())
+    {
+        return;
+    }
+
+    int dx = event->pos().x() - m_dragX;
+    if (abs(dx) > 3)
+    {
+        m_dragged = true;
+    }
+    if (!m_dragged)
+    {
+        return;
+    }
+
+    uint64_t first = m_profile->timestamps.front();
+    uint64_t last = m_profile->timestamps.back();
+    uint64_t span = m_viewEnd - m_viewStart;
+    double msPerPixel = static_cast<double>(span) / plotRect().width();
+
+    double start = static_cast<double>(m_dragStart) - dx * msPerPixel;
+    m_viewStart = static_cast<uint64_t>(clamp(start, static_cast<double>(first), static_cast<double>(last - span)));
+    m_viewEnd = m_viewStart + span;
+
+    requestView();
+    update();
+}
+
+void ProfileChart::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (m_dragX >= 0 && !m_dragged && m_profile != nullptr && !m_profile->empty())
+    {
+        emit clicked(xToTime(event->pos().x()));
+    }
+    m_dragX = -1;
+}
+
+void ProfileChart::mouseDoubleClickEvent(QMouseEvent* event)
+{
+    if (m_profile == nullptr || m_profile->empty())
+    {
+        return;
+    }
+
+    // Back out to the whole flight
+    m_viewStart = m_profile->timestamps.front();
+    m_viewEnd = m_profile->timestamps.back();
+    requestView();
+    update();
+}
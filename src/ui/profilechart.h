@@ -0,0 +1,111 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_PROFILECHART_H
+#define BLACKBOX_PROFILECHART_H
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QComboBox>
+#include <QWidget>
+
+#include "blackbox/profile.h"
+
+// One of a flight's profiles over time. However many samples there are, only the lowest and highest
+// of each pixel column are drawn. Those are worked out on a worker thread and the last few views are
+// cached, so zooming (wheel) and panning (drag) stay smooth.
+class ProfileChart : public QWidget
+{
+    Q_OBJECT
+
+ public:
+    struct View
+    {
+        uint64_t flightId = 0;
+        ProfileSeries series = ProfileSeries::ALTITUDE;
+        uint64_t start = 0;
+        uint64_t end = 0;
+        int buckets = 0;
+
+        bool operator==(const View& other) const = default;
+    };
+
+    struct Decimated
+    {
+        View view;
+        std::vector<float> minimums;
+        std::vector<float> maximums;
+    };
+
+ private:
+    std::string m_dbPath;
+    QComboBox* m_seriesComboBox = nullptr;
+
+    uint64_t m_flightId = 0;
+    std::shared_ptr<const Profile> m_profile;
+    ProfileSeries m_series = ProfileSeries::ALTITUDE;
+
+    // What's being looked at
+    uint64_t m_viewStart = 0;
+    uint64_t m_viewEnd = 0;
+    uint64_t m_cursor = 0;
+
+    // Most recent first
+    std::list<std::shared_ptr<const Decimated>> m_cache;
+    std::shared_ptr<const Decimated> m_shown;
+
+    // Only the latest request matters, anything it replaces is dropped
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_signal;
+    bool m_stopping = false;
+    uint64_t m_loadFlightId = 0;
+    bool m_hasRequest = false;
+    View m_request;
+    std::shared_ptr<const Profile> m_requestProfile;
+
+    int m_dragX = -1;
+    uint64_t m_dragStart = 0;
+    bool m_dragged = false;
+
+    void work();
+    void requestView();
+    void profileLoaded(uint64_t flightId, const std::shared_ptr<const Profile>& profile);
+    void decimated(const std::shared_ptr<const Decimated>& decimated);
+
+    [[nodiscard]] QRect plotRect() const;
+    [[nodiscard]] uint64_t xToTime(int x) const;
+    [[nodiscard]] double timeToX(uint64_t t) const;
+
+ protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+ public:
+    explicit ProfileChart(std::string dbPath, QWidget* parent = nullptr);
+    ~ProfileChart() override;
+
+    // Reads the flight in the background
+    void setFlight(uint64_t flightId);
+    void setSeries(ProfileSeries series);
+
+    // Marks a time, such as where the timeline is
+    void setCursor(uint64_t timestamp);
+
+ signals:
+    void clicked(uint64_t timestamp);
+};
+
+#endif //BLACKBOX_PROFILECHART_H
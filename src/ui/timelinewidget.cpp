@@ -0,0 +1,187 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#include "timelinewidget.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+#include <QHBoxLayout>
+#include <QSignalBlocker>
+
+using namespace std;
+
+// Enough either side of the cursor for a few seconds of playback at 64x
+constexpr uint64_t WINDOW_BEHIND_MS = 60 * 1000;
+constexpr uint64_t WINDOW_AHEAD_MS = 10 * 60 * 1000;
+
+constexpr int PLAY_INTERVAL_MS = 40;
+
+static QString formatTime(uint64_t ms)
+{
+    uint64_t seconds = ms / 1000;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%" PRIu64 ":%02" PRIu64 ":%02" PRIu64, seconds / 3600, (seconds / 60) % 60, seconds % 60);
+    return buf;
+}
+
+TimelineWidget::TimelineWidget(DataStore& dataStore, QWidget* parent) : QWidget(parent), m_dataStore(dataStore)
+{
+    auto layout = new QHBoxLayout();
+    layout->setContentsMargins(0, 0, 0, 0);
+    setLayout(layout);
+
+    m_playButton = new QToolButton();
+    m_playButton->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::MediaPlaybackStart));
+    layout->addWidget(m_playButton);
+    connect(m_playButton, &QToolButton::clicked, this, [this]() { setPlaying(!isPlaying()); });
+
+    m_slider = new QSlider(Qt::Horizontal);
+    layout->addWidget(m_slider, 1);
+    connect(m_slider, &QSlider::valueChanged, this, [this](int value)
+    {
+        seek(m_startTime + static_cast<uint64_t>(value) * 1000);
+    });
+
+    m_speedComboBox = new QComboBox();
+    for (int speed = 1; speed <= 64; speed *= 2)
+    {
+        m_speedComboBox->addItem(QString::number(speed) + "x", speed);
+    }
+    layout->addWidget(m_speedComboBox);
+    connect(m_speedComboBox, &QComboBox::currentIndexChanged, this, [this](int index)
+    {
+        m_speed = m_speedComboBox->itemData(index).toInt();
+    });
+
+    m_timeLabel = new QLabel();
+    layout->addWidget(m_timeLabel);
+
+    connect(&m_playTimer, &QTimer::timeout, this, &TimelineWidget::tick);
+
+    setEnabled(false);
+}
+
+void TimelineWidget::setFlight(uint64_t flightId, uint64_t startTime, uint64_t endTime)
+{
+    setPlaying(false);
+    m_flightId = flightId;
+    m_startTime = startTime;
+    m_cursor = startTime;
+    m_shownTimestamp = 0;
+    m_window.clear();
+    m_windowStart = 0;
+    m_windowEnd = 0;
+    setEndTime(endTime);
+
+    QSignalBlocker blocker(m_slider);
+    m_slider->setValue(0);
+    updateLabel();
+}
+
+void TimelineWidget::setEndTime(uint64_t endTime)
+{
+    // What's been read up to the old end may be missing states from after it
+    if (m_windowEnd >= m_endTime)
+    {
+        m_window.clear();
+        m_windowStart = 0;
+        m_windowEnd = 0;
+    }
+
+    m_endTime = max(endTime, m_startTime);
+    setEnabled(m_flightId != 0 && m_endTime > m_startTime);
+
+    QSignalBlocker blocker(m_slider);
+    m_slider->setRange(0, static_cast<int>((m_endTime - m_startTime) / 1000));
+    updateLabel();
+}
+
+bool TimelineWidget::stateAt(uint64_t timestamp, State& state)
+{
+    if (m_window.empty() || timestamp < m_windowStart || timestamp > m_windowEnd)
+    {
+        m_windowStart = timestamp > m_startTime + WINDOW_BEHIND_MS ? timestamp - WINDOW_BEHIND_MS : m_startTime;
+        m_windowEnd = timestamp + WINDOW_AHEAD_MS;
+        m_window = m_dataStore.fetchWindow(m_flightId, m_windowStart, m_windowEnd);
+    }
+
+    // The last state at or before the cursor
+    auto it = upper_bound(m_window.begin(), m_window.end(), timestamp, [](uint64_t t, const State& s)
+    {
+        return t < s.timestamp;
+    });
+    if (it != m_window.begin())
+    {
+        state = *(it - 1);
+        return true;
+    }
+
+    // Nothing recorded in the window before it, the sim must have been paused
+    return m_dataStore.fetchStateAt(m_flightId, timestamp, state);
+}
+
+void TimelineWidget::moveTo(uint64_t timestamp)
+{
+    m_cursor = clamp(timestamp, m_startTime, m_endTime);
+
+    State state;
+    if (stateAt(m_cursor, state) && state.timestamp != m_shownTimestamp)
+    {
+        m_shownTimestamp = state.timestamp;
+        emit stateChanged(state);
+    }
+    updateLabel();
+}
+
+void TimelineWidget::seek(uint64_t timestamp)
+{
+    if (m_flightId == 0)
+    {
+        return;
+    }
+    moveTo(timestamp);
+}
+
+void TimelineWidget::setPlaying(bool playing)
+{
+    if (playing && m_flightId != 0)
+    {
+        // Start again if it's already at the end
+        if (m_cursor >= m_endTime)
+        {
+            moveTo(m_startTime);
+        }
+        m_lastTick = chrono::steady_clock::now();
+        m_playTimer.start(PLAY_INTERVAL_MS);
+        m_playButton->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::MediaPlaybackPause));
+    }
+    else
+    {
+        m_playTimer.stop();
+        m_playButton->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::MediaPlaybackStart));
+    }
+}
+
+void TimelineWidget::tick()
+{
+    auto now = chrono::steady_clock::now();
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(now - m_lastTick).count();
+    m_lastTick = now;
+
+    moveTo(m_cursor + static_cast<uint64_t>(elapsed) * m_speed);
+
+    QSignalBlocker blocker(m_slider);
+    m_slider->setValue(static_cast<int>((m_cursor - m_startTime) / 1000));
+
+    if (m_cursor >= m_endTime)
+    {
+        setPlaying(false);
+    }
+}
+
+void TimelineWidget::updateLabel()
+{
+    m_timeLabel->setText(formatTime(m_cursor - m_startTime) + " / " + formatTime(m_endTime - m_startTime));
+}
@@ -0,0 +1,71 @@
+//
+// Created by Ian Parker on 19/10/2026.
+//
+
+#ifndef BLACKBOX_TIMELINEWIDGET_H
+#define BLACKBOX_TIMELINEWIDGET_H
+
+#include <chrono>
+#include <vector>
+
+#include <QComboBox>
+#include <QLabel>
+#include <QSlider>
+#include <QTimer>
+#include <QToolButton>
+#include <QWidget>
+
+#include "blackbox/datastore.h"
+
+// Scrubs through a flight and plays it back. Only the states around the cursor are read, so seeking
+// is a lookup on the (flight_id, timestamp) index however long the flight is.
+class TimelineWidget : public QWidget
+{
+    Q_OBJECT
+
+    DataStore& m_dataStore;
+
+    uint64_t m_flightId = 0;
+    uint64_t m_startTime = 0;
+    uint64_t m_endTime = 0;
+    uint64_t m_cursor = 0;
+    uint64_t m_shownTimestamp = 0;
+
+    // States from m_windowStart to m_windowEnd, so playing and small seeks don't go to the database
+    std::vector<State> m_window;
+    uint64_t m_windowStart = 0;
+    uint64_t m_windowEnd = 0;
+
+    int m_speed = 1;
+    QTimer m_playTimer;
+    std::chrono::steady_clock::time_point m_lastTick;
+
+    QToolButton* m_playButton = nullptr;
+    QSlider* m_slider = nullptr;
+    QComboBox* m_speedComboBox = nullptr;
+    QLabel* m_timeLabel = nullptr;
+
+    bool stateAt(uint64_t timestamp, State& state);
+    void moveTo(uint64_t timestamp);
+    void tick();
+    void updateLabel();
+
+ public:
+    explicit TimelineWidget(DataStore& dataStore, QWidget* parent = nullptr);
+    ~TimelineWidget() override = default;
+
+    void setFlight(uint64_t flightId, uint64_t startTime, uint64_t endTime);
+
+    // A live flight keeps getting longer
+    void setEndTime(uint64_t endTime);
+
+    void seek(uint64_t timestamp);
+
+    void setPlaying(bool playing);
+    [[nodiscard]] bool isPlaying() const { return m_playTimer.isActive(); }
+
+ signals:
+    void stateChanged(const State& state);
+};
+
+#endif //BLACKBOX_TIMELINEWIDGET_H